@@ -66,3 +66,63 @@ uint8_t CapCheckPerc(float voltage, int cells) {
 		
 	}
 }
+
+// open circuit voltage of 0, 10, ... 100 % in mV per cell
+static const uint16_t socCurves[3][11] = {
+	{ 3000, 3300, 3450, 3580, 3680, 3750, 3820, 3890, 3960, 4030, 4100 },	// Li-ion NMC
+	{ 2800, 3000, 3130, 3200, 3230, 3260, 3280, 3290, 3300, 3320, 3400 },	// LiFePO4
+	{ 2800, 3150, 3350, 3480, 3570, 3650, 3750, 3850, 3950, 4050, 4150 }	// Li-ion Molicel
+};
+
+static uint8_t socTable[SOC_MAX_MV - SOC_MIN_MV + 1];
+
+void SocInit(uint8_t chemistry) {
+	if (chemistry > CHEM_LIION_MOLICEL)
+	{
+		chemistry = CHEM_LIION_NMC;
+	}
+	const uint16_t *curve = socCurves[chemistry];
+	int ind = 0;
+
+	for (int mv = SOC_MIN_MV; mv <= SOC_MAX_MV; mv++)
+	{
+		uint8_t perc;
+		if (mv <= curve[0])
+		{
+			perc = 0;
+		}
+		else if (mv >= curve[10])
+		{
+			perc = 100;
+		}
+		else
+		{
+			while (mv > curve[ind + 1])
+			{
+				ind++;
+			}
+			// linear between the points, rounded
+			int span = curve[ind + 1] - curve[ind];
+			perc = ind * 10 + ((mv - curve[ind]) * 10 + span / 2) / span;
+		}
+		socTable[mv - SOC_MIN_MV] = perc;
+	}
+}
+
+uint8_t SocCheckPerc(uint32_t packMv, int cells) {
+	if (cells <= 0)
+	{
+		return 0;
+	}
+	uint32_t cellMv = packMv / cells;
+
+	if (cellMv <= SOC_MIN_MV)
+	{
+		return socTable[0];
+	}
+	if (cellMv >= SOC_MAX_MV)
+	{
+		return socTable[SOC_MAX_MV - SOC_MIN_MV];
+	}
+	return socTable[cellMv - SOC_MIN_MV];
+}
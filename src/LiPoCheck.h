@@ -27,5 +27,21 @@ uint8_t CountCells(float voltage);
 
 uint8_t CapCheckPerc(float voltage, int cells);
 
+// State of charge from a dense per millivolt table, built once by SocInit()
+#define SOC_MIN_MV      2500
+#define SOC_MAX_MV      4250
+
+enum BattChemistry
+{
+	CHEM_LIION_NMC = 0,		// generic Li-ion, same curve as liionDC
+	CHEM_LIFEPO4 = 1,
+	CHEM_LIION_MOLICEL = 2	// high drain Li-ion (P42A/P45B style), flatter top, longer tail
+};
+
+void SocInit(uint8_t chemistry);
+
+// packMv is the full resolution pack voltage in mV, returns 0-100 %
+uint8_t SocCheckPerc(uint32_t packMv, int cells);
+
 #endif
 
@@ -1,8 +1,22 @@
 // Compatible with VESC FW3.49 //also tested with 6.02
 
 #include "VescComms.h"
+#include "latency.h"
+#if BOOSTED_BMS
+#include "boostedBms.h"
+#endif
 #include <HardwareSerial.h>
 
+#define UART_TX_FIFO_LEN 128
+#ifndef BOOSTED_KEEPALIVE_ID
+#define BOOSTED_KEEPALIVE_ID 0x0B57ED1F // keep-alive ping that keeps a Boosted BMS awake
+#endif
+#define CAN_FRAME_OVERHEAD 8
+
+// the bus byte counter is updated from the sending and the receiving task
+static portMUX_TYPE busBytesMux = portMUX_INITIALIZER_UNLOCKED;
+#define DBMS_VALUES_LEN 49 // packet id + 48 bytes of values
+
 VescComms::VescComms(void) {
   nunchuck.valueX = 127;
   nunchuck.valueY = 127;
@@ -30,6 +44,7 @@ void VescComms::beginCAN(int txPin, int rxPin, uint8_t controllerId, uint8_t own
   _ownId = ownId;
 
   twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)txPin, (gpio_num_t)rxPin, TWAI_MODE_NORMAL);
+  g_config.rx_queue_len = 32; // broadcasts (BMS, other controllers) arrive between our polls
   twai_timing_config_t t_config;
   #if CAN_BAUD_RATE == 250000
     t_config = TWAI_TIMING_CONFIG_250KBITS();
@@ -57,13 +72,14 @@ void VescComms::comm_can_transmit_eid(uint32_t id, const uint8_t *data, uint8_t
   message.extd = 1;
   message.data_length_code = len;
   memcpy(message.data, data, len);
-  twai_transmit(&message, pdMS_TO_TICKS(10));
+  if (twai_transmit(&message, pdMS_TO_TICKS(10)) == ESP_OK)
+    addBusBytes(len + CAN_FRAME_OVERHEAD);
 }
 
-int VescComms::sendCanPayload(uint8_t *payload, int len) {
+int VescComms::sendCanPayload(uint8_t *payload, int len, uint8_t targetId) {
   if (len <= 6) {
     // Send Short Buffer
-    uint32_t id = (CAN_PACKET_PROCESS_SHORT_BUFFER << 8) | _canId;
+    uint32_t id = (CAN_PACKET_PROCESS_SHORT_BUFFER << 8) | targetId;
     uint8_t data[8];
     data[0] = _ownId;
     data[1] = 0; // Reserved
@@ -81,7 +97,7 @@ int VescComms::sendCanPayload(uint8_t *payload, int len) {
       if (chunkLen > 7)
         chunkLen = 7;
 
-      uint32_t id = (CAN_PACKET_FILL_RX_BUFFER << 8) | _canId;
+      uint32_t id = (CAN_PACKET_FILL_RX_BUFFER << 8) | targetId;
       uint8_t data[8];
       data[0] =
           i; // Index (Byte offset? No, "block index" or byte index? VESC commands.c: buffer[data[0]] = data[1]... wait.
@@ -107,7 +123,7 @@ int VescComms::sendCanPayload(uint8_t *payload, int len) {
     data[4] = crcVal >> 8;
     data[5] = crcVal & 0xFF;
 
-    uint32_t id = (CAN_PACKET_PROCESS_RX_BUFFER << 8) | _canId;
+    uint32_t id = (CAN_PACKET_PROCESS_RX_BUFFER << 8) | targetId;
     comm_can_transmit_eid(id, data, 6);
   }
   return len;
@@ -116,6 +132,12 @@ int VescComms::sendCanPayload(uint8_t *payload, int len) {
 int VescComms::receiveCanMessage(uint8_t *payloadReceived) {
   twai_message_t message;
   while (twai_receive(&message, 0) == ESP_OK) { // Non-blocking check
+    addBusBytes(message.data_length_code + CAN_FRAME_OVERHEAD);
+#if BOOSTED_BMS && BOOSTED_BMS_DECODER
+    // BMS broadcasts are not addressed to us
+    if (boostedBmsDecode(message.identifier, message.extd, message.data, message.data_length_code))
+      continue;
+#endif
     if (!message.extd)
       continue;
 
@@ -130,6 +152,10 @@ int VescComms::receiveCanMessage(uint8_t *payloadReceived) {
       if (message.data_length_code > 2) {
         int len = message.data_length_code - 2;
         memcpy(payloadReceived, &message.data[2], len);
+        if (_dieBieMSId != 0 && message.data[0] == _dieBieMSId) {
+          processReadPacket(true, payloadReceived, len); // BMS reply, not what the caller waits for
+          continue;
+        }
         return len;
       }
     }
@@ -150,6 +176,10 @@ int VescComms::receiveCanMessage(uint8_t *payloadReceived) {
           uint16_t crcCalc = crc16(canRxBuffer, len);
           if (crcCalc == crcRx) {
             memcpy(payloadReceived, canRxBuffer, len);
+            if (_dieBieMSId != 0 && message.data[0] == _dieBieMSId) {
+              processReadPacket(true, payloadReceived, len);
+              continue;
+            }
             return len;
           }
         }
@@ -218,6 +248,7 @@ int VescComms::receiveUartMessage(uint8_t *payloadReceived) {
       }
     }
   }
+  addBusBytes(counter);
   if (messageRead == false && debugPort != NULL) {
     debugPort->println("Timeout");
   }
@@ -283,7 +314,7 @@ bool VescComms::unpackPayload(uint8_t *message, int lenMes, uint8_t *payload) {
 
 int VescComms::packSendPayload(uint8_t *payload, int lenPay) {
   if (_useCAN) {
-    return sendCanPayload(payload, lenPay);
+    return sendCanPayload(payload, lenPay, _canId);
   }
 
   uint16_t crcPayload = crc16(payload, lenPay);
@@ -315,12 +346,13 @@ int VescComms::packSendPayload(uint8_t *payload, int lenPay) {
 
   // Sending package
   serialPort->write(messageSend, count);
+  addBusBytes(count);
 
   // Returns number of send bytes
   return count;
 }
 
-bool VescComms::processReadPacket(bool deviceType, uint8_t *message) {
+bool VescComms::processReadPacket(bool deviceType, uint8_t *message, int len) {
 
   COMM_PACKET_ID packetId;
   COMM_PACKET_ID_DIEBIEMS packetIdDieBieMS;
@@ -398,17 +430,14 @@ bool VescComms::processReadPacket(bool deviceType, uint8_t *message) {
       }
       // Others values are ignored. You can add them here accordingly to commands.c in VESC Firmware. Please add those
       // variables in "struct dataPackage" in VescUart.h file.
+      _valuesMask |= mask & 0xFFFF;
 
       return true;
     }
 
     case COMM_GET_VALUES_SETUP_SELECTIVE: { // Structure defined here:
                                             // https://github.com/vedderb/bldc/blob/43c3bbaf91f5052a35b75c2ff17b5fe99fad94d1/commands.c#L164
-      uint32_t mask = 0;
-      mask += ind++ << 24;
-      mask += ind++ << 16;
-      mask += ind++ << 8;
-      mask += ind++;
+      uint32_t mask = buffer_get_uint32(message, &ind);
 
       if (mask & ((uint32_t)1 << 0)) {
         data.tempFET = buffer_get_float16(message, 10.0, &ind);
@@ -426,14 +455,17 @@ bool VescComms::processReadPacket(bool deviceType, uint8_t *message) {
         data.dutyCycleNow = buffer_get_float16(message, 1000.0, &ind);
       }
       if (mask & ((uint32_t)1 << 5)) {
-        data.rpm = buffer_get_int32(message, &ind);
+        setup.rpm = buffer_get_float32(message, 1.0, &ind);
+        data.rpm = setup.rpm;
+      }
+      if (mask & ((uint32_t)1 << 6)) {
+        setup.speed = buffer_get_float32(message, 1000.0, &ind);
       }
-      if (mask & ((uint32_t)1 << 6)) { /* speed */
-      };
       if (mask & ((uint32_t)1 << 7)) {
         data.inpVoltage = buffer_get_float16(message, 10.0, &ind);
       }
-      if (mask & ((uint32_t)1 << 8)) { /* batt level */
+      if (mask & ((uint32_t)1 << 8)) {
+        setup.battLevel = buffer_get_float16(message, 1000.0, &ind);
       }
       if (mask & ((uint32_t)1 << 9)) {
         data.ampHours = buffer_get_float32(message, 10000.0, &ind);
@@ -447,17 +479,21 @@ bool VescComms::processReadPacket(bool deviceType, uint8_t *message) {
       if (mask & ((uint32_t)1 << 12)) {
         data.watt_hours_charged = buffer_get_float32(message, 10000.0, &ind);
       }
-      if (mask & ((uint32_t)1 << 13)) { /* distance */
+      if (mask & ((uint32_t)1 << 13)) {
+        setup.distance = buffer_get_float32(message, 1000.0, &ind);
       }
-      if (mask & ((uint32_t)1 << 14)) { /* distance absolute */
+      if (mask & ((uint32_t)1 << 14)) {
+        setup.distanceAbs = buffer_get_float32(message, 1000.0, &ind);
       }
       if (mask & ((uint32_t)1 << 15)) { /* PID pos */
+        ind += 4;
       }
       if (mask & ((uint32_t)1 << 16)) {
         data.fault = message[ind];
       }
       // Others values are ignored. You can add them here accordingly to commands.c in VESC Firmware. Please add those
       // variables in "struct dataPackage" in VescUart.h file.
+      setup.count++;
 
       return true;
     }
@@ -490,41 +526,70 @@ bool VescComms::processReadPacket(bool deviceType, uint8_t *message) {
     case DBMS_COMM_GET_VALUES: // Structure defined here:
                                // https://github.com/DieBieEngineering/DieBieMS-Firmware/blob/master/Modules/Src/modCommands.c
 
-      ind = 45;
-      // DieBieMSdata.packVoltage = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.packCurrent = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.cellVoltageHigh = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.cellVoltageAverage = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.cellVoltageLow = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.cellVoltageMisMatch = buffer_get_float32(message, 1000.0, &ind);
-      // DieBieMSdata.loCurrentLoadVoltage = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.loCurrentLoadCurrent = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.hiCurrentLoadVoltage = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.hiCurrentLoadCurrent = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.auxVoltage = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.auxCurrent = buffer_get_float16(message, 100.0, &ind);
-      // DieBieMSdata.tempBatteryHigh = buffer_get_float16(message, 10.0, &ind);
-      // DieBieMSdata.tempBatteryAverage = buffer_get_float16(message, 10.0, &ind);
-      // DieBieMSdata.tempBMSHigh = buffer_get_float16(message, 10.0, &ind);
-      // DieBieMSdata.tempBMSAverage = buffer_get_float16(message, 10.0, &ind);
+      if (len < DBMS_VALUES_LEN)
+        return false;
+
+      DieBieMSdata.packVoltage = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.packCurrent = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.soc = message[ind++];
+      DieBieMSdata.cellVoltageHigh = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.cellVoltageAverage = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.cellVoltageLow = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.cellVoltageMisMatch = buffer_get_float32(message, 1000.0, &ind);
+      DieBieMSdata.loCurrentLoadVoltage = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.loCurrentLoadCurrent = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.hiCurrentLoadVoltage = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.hiCurrentLoadCurrent = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.auxVoltage = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.auxCurrent = buffer_get_float16(message, 100.0, &ind);
+      DieBieMSdata.tempBatteryHigh = buffer_get_float16(message, 10.0, &ind);
+      DieBieMSdata.tempBatteryAverage = buffer_get_float16(message, 10.0, &ind);
+      DieBieMSdata.tempBMSHigh = buffer_get_float16(message, 10.0, &ind);
+      DieBieMSdata.tempBMSAverage = buffer_get_float16(message, 10.0, &ind);
       DieBieMSdata.operationalState = message[ind++];
-      // DieBieMSdata.chargeBalanceActive = message[ind++];
-      // DieBieMSdata.faultState = message[ind++];
+      DieBieMSdata.chargeBalanceActive = message[ind++];
+      DieBieMSdata.faultState = message[ind++];
+      DieBieMSlastMs = millis();
 
       return true;
       break;
 
-    case DBMS_COMM_GET_BMS_CELLS: // Structure defined here:
-                                  // https://github.com/DieBieEngineering/DieBieMS-Firmware/blob/master/Modules/Src/modCommands.c
+    case DBMS_COMM_GET_BMS_CELLS: { // Structure defined here:
+                                    // https://github.com/DieBieEngineering/DieBieMS-Firmware/blob/master/Modules/Src/modCommands.c
+      if (len < 2)
+        return false;
 
       DieBieMScells.noOfCells = message[ind++];
 
-      for (uint8_t i = 0; i < 12; i++) {
-        DieBieMScells.cellsVoltage[i] = buffer_get_float16(message, 1000.0, &ind);
-      }
+      // only as many cells as the array and the received payload hold
+      int cells = DieBieMScells.noOfCells;
+      if (cells > DIEBIEMS_MAX_CELLS)
+        cells = DIEBIEMS_MAX_CELLS;
+      if (cells > (len - 2) / 2)
+        cells = (len - 2) / 2;
+
+      // min, max and average in the same pass
+      float cellMin = 0;
+      float cellMax = 0;
+      float cellSum = 0;
+      for (int i = 0; i < cells; i++) {
+        float v = buffer_get_float16(message, 1000.0, &ind);
+        DieBieMScells.cellsVoltage[i] = v;
+        if (i == 0 || v < cellMin)
+          cellMin = v;
+        if (i == 0 || v > cellMax)
+          cellMax = v;
+        cellSum += v;
+      }
+      DieBieMScells.cellsReceived = cells;
+      DieBieMScells.cellMin = cellMin;
+      DieBieMScells.cellMax = cellMax;
+      DieBieMScells.cellAverage = cells > 0 ? cellSum / cells : 0;
+      DieBieMScells.cellSpread = cellMax - cellMin;
+      DieBieMSlastMs = millis();
 
       return true;
-      break;
+    }
 
     default:
       return false;
@@ -544,7 +609,7 @@ bool VescComms::getVescValues(void) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            // && lenPayload < 55) {
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -566,8 +631,9 @@ bool VescComms::getVescValuesSelective(uint32_t mask) {
 
   int lenPayload = receiveUartMessage(payload);
 
-  if (lenPayload > 0 && lenPayload < 55) {
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+  // all 16 fields are 58 bytes with the id and mask, the payload buffer holds any reply
+  if (lenPayload > 0) {
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -590,7 +656,7 @@ bool VescComms::getVescValuesSetupSelective(uint32_t mask) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0 && lenPayload < 55) {
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -609,7 +675,7 @@ bool VescComms::getLocalVescPPM(void) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            //&& lenPayload < 55
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -632,7 +698,7 @@ bool VescComms::getMasterVescPPM(uint8_t id) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            //&& lenPayload < 55
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -650,7 +716,7 @@ bool VescComms::getLocalVescNun(void) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            //&& lenPayload < 55
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -672,7 +738,7 @@ bool VescComms::getMasterVescNun(uint8_t id) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            //&& lenPayload < 55
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -691,7 +757,7 @@ bool VescComms::getFWversion(void) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                            //&& lenPayload < 55
-    bool read = processReadPacket(false, payload); // returns true if sucessful
+    bool read = processReadPacket(false, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -700,6 +766,13 @@ bool VescComms::getFWversion(void) {
 }
 
 bool VescComms::getDieBieMSValues(uint8_t id) {
+  if (_useCAN) {
+    // straight to the BMS, the reply is recognized by its sender in receiveCanMessage()
+    uint8_t request[1] = {DBMS_COMM_GET_VALUES};
+    _dieBieMSId = id;
+    return sendCanPayload(request, 1, id) > 0;
+  }
+
   uint8_t command[3];
   command[0] = {COMM_FORWARD_CAN}; // VESC command
   command[1] = id;
@@ -713,7 +786,7 @@ bool VescComms::getDieBieMSValues(uint8_t id) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                           //&& lenPayload < 55
-    bool read = processReadPacket(true, payload); // returns true if sucessful
+    bool read = processReadPacket(true, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -722,6 +795,13 @@ bool VescComms::getDieBieMSValues(uint8_t id) {
 }
 
 bool VescComms::getDieBieMSCellsVoltage(uint8_t id) {
+  if (_useCAN) {
+    // straight to the BMS, the reply is recognized by its sender in receiveCanMessage()
+    uint8_t request[1] = {DBMS_COMM_GET_BMS_CELLS};
+    _dieBieMSId = id;
+    return sendCanPayload(request, 1, id) > 0;
+  }
+
   uint8_t command[3];
   command[0] = {COMM_FORWARD_CAN}; // VESC command
   command[1] = id;
@@ -735,7 +815,7 @@ bool VescComms::getDieBieMSCellsVoltage(uint8_t id) {
   int lenPayload = receiveUartMessage(payload);
 
   if (lenPayload > 0) {                           //&& lenPayload < 55
-    bool read = processReadPacket(true, payload); // returns true if sucessful
+    bool read = processReadPacket(true, payload, lenPayload); // returns true if sucessful
     return read;
   }
   else {
@@ -774,6 +854,7 @@ void VescComms::setNunchuckValues() {
   }
 
   packSendPayload(payload, 11);
+  LATENCY_MARK(LAT_ENQUEUE, micros());
 }
 
 void VescComms::setCurrent(float current) {
@@ -784,6 +865,7 @@ void VescComms::setCurrent(float current) {
   buffer_append_int32(payload, (int32_t)(current * 1000), &index);
 
   packSendPayload(payload, 5);
+  LATENCY_MARK(LAT_ENQUEUE, micros());
 }
 
 void VescComms::setBrakeCurrent(float brakeCurrent) {
@@ -794,6 +876,7 @@ void VescComms::setBrakeCurrent(float brakeCurrent) {
   buffer_append_int32(payload, (int32_t)(brakeCurrent * 1000), &index);
 
   packSendPayload(payload, 5);
+  LATENCY_MARK(LAT_ENQUEUE, micros());
 }
 
 void VescComms::setRPM(float rpm) {
@@ -816,10 +899,36 @@ void VescComms::setDuty(float duty) {
   packSendPayload(payload, 5);
 }
 
+bool VescComms::txIdle(void) {
+  if (_useCAN) {
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) != ESP_OK)
+      return true;
+    return status.msgs_to_tx == 0;
+  }
+  return serialPort == NULL || serialPort->availableForWrite() >= UART_TX_FIFO_LEN;
+}
+
+void VescComms::addBusBytes(uint32_t count) {
+  portENTER_CRITICAL(&busBytesMux);
+  _busBytes += count;
+  portEXIT_CRITICAL(&busBytesMux);
+}
+
+uint32_t VescComms::busBytes(void) {
+  return _busBytes; // an aligned 32 bit read is atomic
+}
+
+uint32_t VescComms::takeValuesMask(void) {
+  uint32_t mask = _valuesMask;
+  _valuesMask = 0;
+  return mask;
+}
+
 void VescComms::sendKeepAlive(void) {
     if (_useCAN) {
         uint8_t payload[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-        comm_can_transmit_eid(0x0B57ED1F, payload, 8);
+        comm_can_transmit_eid(BOOSTED_KEEPALIVE_ID, payload, 8);
     }
 }
 
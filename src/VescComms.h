@@ -7,6 +7,10 @@
 #include "buffer.h"
 #include "crc.h"
 
+#ifndef DIEBIEMS_MAX_CELLS
+#define DIEBIEMS_MAX_CELLS 24
+#endif
+
 class VescComms
 {
 	/** Struct to store the telemetry data returned by the VESC */
@@ -58,8 +62,24 @@ class VescComms
 
 	struct DieBieMScellsPackage
 	{
-		uint8_t noOfCells;
-		float cellsVoltage[11];
+		uint8_t noOfCells;     // reported by the BMS
+		uint8_t cellsReceived; // stored in cellsVoltage, at most DIEBIEMS_MAX_CELLS
+		float cellsVoltage[DIEBIEMS_MAX_CELLS];
+		float cellMin;
+		float cellMax;
+		float cellAverage;
+		float cellSpread;      // max - min
+	};
+
+	/** Struct to store the values returned by COMM_GET_VALUES_SETUP_SELECTIVE, scaled by the VESC setup */
+	struct setupPackage
+	{
+		float rpm;         // eRPM of the same reply as the speed
+		float speed;       // m/s
+		float battLevel;   // 0-1
+		float distance;    // m
+		float distanceAbs; // m
+		uint32_t count;    // number of decoded replies
 	};
 
 	struct FWversionPackage
@@ -89,6 +109,9 @@ public:
 	/** Variable to hold measurements returned from VESC */
 	FWversionPackage fw_version;
 
+	/** Variable to hold the setup values returned from VESC */
+	setupPackage setup;
+
 	/** Variabel to hold nunchuck values */
 	nunchuckPackage nunchuck;
 
@@ -201,18 +224,24 @@ public:
 
 	/**
 		 * @brief      Sends a command to DieBieMS over CAN and stores the returned data
+		 *             With beginCAN the request goes straight to the BMS and returns without waiting,
+		 *             the reply is decoded by the receive path whenever it arrives
 		 * @param			id - CAN ID of DieBieMS (default is 10)
-		 * @return     True if successfull otherwise false
+		 * @return     True if successfull (CAN: request sent) otherwise false
 		 */
 	bool getDieBieMSValues(uint8_t id);
 
 	/**
 		 * @brief      Sends a command to DieBieMS over CAN and stores the returned cells voltage
+		 *             With beginCAN the request goes straight to the BMS and returns without waiting
 		 * @param			id - CAN ID of DieBieMS (default is 10)
-		 * @return     True if successfull otherwise false
+		 * @return     True if successfull (CAN: request sent) otherwise false
 		 */
 	bool getDieBieMSCellsVoltage(uint8_t id);
 
+	/** millis() of the last decoded DieBieMS reply, 0 = none yet */
+	uint32_t DieBieMSlastMs = 0;
+
 	/**
 		 * @brief      Set a profile
 		 * @param	   store save persistently the new profile in vesc memory
@@ -229,6 +258,25 @@ public:
 		 */
 	void setLocalProfile(bool store, bool forward_can, bool divide_by_controllers, float current_min_rel, float current_max_rel, float speed_max_reverse, float speed_max, float duty_min, float duty_max, float watt_min, float watt_max);
     
+	/**
+		 * @brief      Check if all queued commands left the controller (TWAI or UART TX FIFO empty)
+		 * @return     True if nothing is waiting to be sent
+		 */
+	bool txIdle(void);
+
+	/**
+		 * @brief      Bytes sent and received on the bus since start, CAN frames count with their frame overhead
+		 * @return     Byte counter, wraps around
+		 */
+	uint32_t busBytes(void);
+
+	/**
+		 * @brief      Fields decoded from COMM_GET_VALUES(_SELECTIVE) replies since the last call, in
+		 *             COMM_GET_VALUES_SELECTIVE mask bits. Over CAN a reply can arrive with a later call.
+		 * @return     Field mask, cleared by the call
+		 */
+	uint32_t takeValuesMask(void);
+
     /**
      * @brief Send Keep Alive Ping (0x0B57ED1F) to Boosted BMS
      */
@@ -276,9 +324,10 @@ private:
 		 *
 		 * @param			deviceType - 0 if VESC, 1 if DieBieMS
 		 * @param      message  - The payload to extract data from
+		 * @param      len      - Length of the payload
 		 * @return     True if the process was a success
 		 */
-	bool processReadPacket(bool deviceType, uint8_t *message);
+	bool processReadPacket(bool deviceType, uint8_t *message, int len);
 
 	/**
 		 * @brief      Help Function to print uint8_t array over Serial for Debug
@@ -325,13 +374,17 @@ private:
     } CAN_PACKET_ID;
 
     bool _useCAN = false;
+    uint8_t _dieBieMSId = 0; // replies from this sender are DieBieMS packets
+    volatile uint32_t _busBytes = 0;
+    uint32_t _valuesMask = 0; // fields decoded since takeValuesMask()
     uint8_t _canId = 0;
     uint8_t _ownId = 0;
 
 private:
-   int sendCanPayload(uint8_t *payload, int len);
+   int sendCanPayload(uint8_t *payload, int len, uint8_t targetId);
    int receiveCanMessage(uint8_t *payloadReceived);
    void comm_can_transmit_eid(uint32_t id, const uint8_t *data, uint8_t len);
+   void addBusBytes(uint32_t count);
 };
 
 #endif
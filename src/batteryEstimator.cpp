@@ -0,0 +1,98 @@
+#include "batteryEstimator.h"
+#include "LiPoCheck.h"
+
+#define R_CELL_START 0.010f // Ohm per cell until the first steps are learned
+#define R_MAX 1.0f          // larger pack resistance is taken as a measurement error
+#define R_STEP_A 4.0f       // current step needed to learn the resistance
+#define R_STEP_MS 500       // max time between the two samples of a step
+#define R_GAIN 0.05f        // learning rate of the resistance
+#define REST_A 2.0f         // below this current the voltage is trusted more
+#define TAU_REST_S 30.0f    // pull towards the voltage at rest
+#define TAU_LOAD_S 300.0f   // pull towards the voltage under load
+#define TAU_VOLT_S 5.0f     // smoothing without coulomb counting
+#define MAX_DT_S 5.0f
+
+BatteryEstimator::BatteryEstimator(uint8_t cells, float capacityAh) {
+  _cells = cells > 0 ? cells : 1;
+  _capacityAh = capacityAh;
+  _r = R_CELL_START * _cells;
+}
+
+void BatteryEstimator::setPack(uint8_t cells, float capacityAh) {
+  if (cells == 0)
+    cells = 1;
+  if (cells != _cells) {
+    _cells = cells;
+    _r = R_CELL_START * _cells;
+    _init = false; // start again from the voltage
+  }
+  _capacityAh = capacityAh;
+}
+
+float BatteryEstimator::socFromOcv(float ocv) {
+  return SocCheckPerc(ocv > 0 ? ocv * 1000 : 0, _cells);
+}
+
+void BatteryEstimator::update(float voltage, float current, uint32_t nowMs) {
+  if (voltage < 1.0f)
+    return; // no telemetry yet
+
+  if (!_init) {
+    _ocv = voltage + current * _r;
+    _soc = socFromOcv(_ocv);
+    _lastV = voltage;
+    _lastI = current;
+    _lastMs = nowMs;
+    _init = true;
+    return;
+  }
+
+  uint32_t dtMs = nowMs - _lastMs;
+  float dt = dtMs / 1000.0f;
+  if (dt > MAX_DT_S)
+    dt = MAX_DT_S;
+
+  // resistance from the voltage step of a current step, both samples close together
+  float dI = current - _lastI;
+  if (dtMs <= R_STEP_MS && fabsf(dI) >= R_STEP_A) {
+    float r = (_lastV - voltage) / dI;
+    if (r > 0 && r < R_MAX)
+      _r += (r - _r) * R_GAIN;
+  }
+  _lastV = voltage;
+  _lastI = current;
+  _lastMs = nowMs;
+
+  _ocv = voltage + current * _r;
+  float tau = TAU_VOLT_S;
+  if (_capacityAh > 0)
+    tau = fabsf(current) < REST_A ? TAU_REST_S : TAU_LOAD_S;
+  _soc += (socFromOcv(_ocv) - _soc) * dt / (dt + tau);
+}
+
+void BatteryEstimator::updateCharge(float ampHours, float ampHoursCharged) {
+  float net = ampHours - ampHoursCharged;
+  if (!_ahInit) {
+    _netAh = net;
+    _ahInit = true;
+    return;
+  }
+  // counters restart with the VESC, take the new value as reference
+  if (_capacityAh > 0 && _init && fabsf(net - _netAh) < _capacityAh) {
+    _soc -= (net - _netAh) / _capacityAh * 100;
+    _soc = constrain(_soc, 0.0f, 100.0f);
+  }
+  _netAh = net;
+}
+
+float BatteryEstimator::soc(void) {
+  return _soc;
+}
+
+float BatteryEstimator::resistance(void) {
+  return _r;
+}
+
+float BatteryEstimator::ocv(void) {
+  return _ocv;
+}
@@ -0,0 +1,65 @@
+#ifndef _BATTERYESTIMATOR_H
+#define _BATTERYESTIMATOR_H
+
+#include <Arduino.h>
+
+/*
+Battery state of charge from VESC telemetry. Coulomb counting (ampHours - ampHoursCharged) carries
+the estimate, the open circuit voltage pulls it back slowly. The open circuit voltage is the
+measured voltage plus the sag I * R; R is learned from voltage steps at current steps.
+Needs SocInit() of LiPoCheck for the voltage curve.
+*/
+
+class BatteryEstimator {
+public:
+  /**
+   * @brief      Class constructor
+   * @param      cells       - Cells in series
+   * @param      capacityAh  - Pack capacity, 0 = no coulomb counting, only the compensated voltage
+   */
+  BatteryEstimator(uint8_t cells, float capacityAh);
+
+  /**
+   * @brief      Change the pack, restarts the resistance learning if the cell count changed
+   */
+  void setPack(uint8_t cells, float capacityAh);
+
+  /**
+   * @brief      Voltage and current taken in the same telemetry reply
+   * @param      voltage  - Pack voltage in V
+   * @param      current  - Battery current in A, positive when discharging
+   * @param      nowMs    - Time of the sample
+   */
+  void update(float voltage, float current, uint32_t nowMs);
+
+  /**
+   * @brief      Charge counters of the VESC, counted since its start
+   */
+  void updateCharge(float ampHours, float ampHoursCharged);
+
+  // State of charge 0-100 %
+  float soc(void);
+
+  // Learned pack resistance in Ohm
+  float resistance(void);
+
+  // Open circuit voltage of the last sample
+  float ocv(void);
+
+private:
+  uint8_t _cells;
+  float _capacityAh;
+  bool _init = false;
+  bool _ahInit = false;
+  float _soc = 0;
+  float _r;
+  float _ocv = 0;
+  float _lastV = 0;
+  float _lastI = 0;
+  uint32_t _lastMs = 0;
+  float _netAh = 0;
+
+  float socFromOcv(float ocv);
+};
+
+#endif
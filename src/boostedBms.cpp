@@ -0,0 +1,89 @@
+#include "boostedBms.h"
+#include "esp_timer.h"
+
+static VescComms *keepAliveVesc = NULL;
+static esp_timer_handle_t keepAliveTimer = NULL;
+
+static void keepAliveCb(void *arg) {
+  keepAliveVesc->sendKeepAlive();
+}
+
+void boostedBmsBegin(VescComms *vesc, uint32_t keepAliveMs) {
+  keepAliveVesc = vesc;
+  vesc->sendKeepAlive();
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = keepAliveCb;
+  timerArgs.name = "bmsKeepAlive";
+  if (esp_timer_create(&timerArgs, &keepAliveTimer) == ESP_OK)
+    esp_timer_start_periodic(keepAliveTimer, keepAliveMs * 1000ULL);
+}
+
+#if BOOSTED_BMS_DECODER
+enum BoostedFrame {
+  BB_PACK = 0,
+  BB_CELLS,
+  BB_TEMPS,
+  BB_FAULT
+};
+
+struct BoostedFrameDef {
+  uint32_t id;
+  uint8_t minLen;
+  BoostedFrame frame;
+};
+
+static const BoostedFrameDef frameDefs[] = {
+    {BOOSTED_ID_PACK, 5, BB_PACK},
+    {BOOSTED_ID_CELLS, 4, BB_CELLS},
+    {BOOSTED_ID_TEMPS, 2, BB_TEMPS},
+    {BOOSTED_ID_FAULT, 4, BB_FAULT},
+};
+
+static BoostedBmsData bms;
+static volatile bool seen = false;
+bool boostedBmsDecode(uint32_t id, bool extd, const uint8_t *data, uint8_t len) {
+  if (!extd)
+    return false;
+
+  for (size_t i = 0; i < sizeof(frameDefs) / sizeof(frameDefs[0]); i++) {
+    const BoostedFrameDef &def = frameDefs[i];
+    if (def.id != id)
+      continue;
+    if (len < def.minLen)
+      return true; // ours, but short
+
+    int32_t ind = 0;
+    switch (def.frame) {
+    case BB_PACK:
+      bms.packVoltage = buffer_get_uint16(data, &ind) / 100.0;
+      bms.packCurrent = buffer_get_int16(data, &ind) / 100.0;
+      bms.soc = data[ind++];
+      break;
+    case BB_CELLS:
+      bms.cellMin = buffer_get_uint16(data, &ind) / 1000.0;
+      bms.cellMax = buffer_get_uint16(data, &ind) / 1000.0;
+      break;
+    case BB_TEMPS:
+      bms.tempHigh = (int8_t)data[0];
+      bms.tempLow = (int8_t)data[1];
+      break;
+    case BB_FAULT:
+      bms.faults = buffer_get_uint32(data, &ind);
+      break;
+    }
+    bms.lastMs = millis();
+    seen = true;
+    return true;
+  }
+  return false;
+}
+
+const BoostedBmsData &boostedBms() {
+  return bms;
+}
+
+bool boostedBmsValid() {
+  return seen && millis() - bms.lastMs < BOOSTED_TIMEOUT_MS;
+}
+#endif
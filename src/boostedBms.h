@@ -0,0 +1,69 @@
+#ifndef _BOOSTEDBMS_H
+#define _BOOSTEDBMS_H
+
+#include <Arduino.h>
+#include "VescComms.h"
+
+/*
+Boosted battery BMS on the CAN bus (BOOSTED_BMS). The BMS only stays awake with a keep-alive
+frame (VescComms::sendKeepAlive), which is sent by an esp_timer.
+
+Optional passive decoder for its broadcast frames, picked out of the CAN receive path of
+VescComms, nothing is polled. EXPERIMENTAL and not built by default (BOOSTED_BMS_DECODER=0):
+the frame ids and layouts below are unverified placeholders, there is neither a specification
+nor a capture behind them. Before enabling the decoder, record the bus of your own pack and
+override the ids with build flags (all values big endian).
+*/
+
+#ifndef BOOSTED_BMS_DECODER
+#define BOOSTED_BMS_DECODER 0
+#endif
+
+#define BOOSTED_KEEPALIVE_MS 10000
+#define BOOSTED_TIMEOUT_MS 2000 // snapshot is stale without frames
+
+// Start the keep-alive timer
+void boostedBmsBegin(VescComms *vesc, uint32_t keepAliveMs = BOOSTED_KEEPALIVE_MS);
+
+#if BOOSTED_BMS_DECODER
+
+#ifndef BOOSTED_ID_PACK
+#define BOOSTED_ID_PACK 0x0B57ED10 // u16 pack voltage 10 mV, i16 current 10 mA (+ = discharge), u8 SoC %
+#endif
+#ifndef BOOSTED_ID_CELLS
+#define BOOSTED_ID_CELLS 0x0B57ED11 // u16 lowest cell mV, u16 highest cell mV
+#endif
+#ifndef BOOSTED_ID_TEMPS
+#define BOOSTED_ID_TEMPS 0x0B57ED12 // i8 highest, i8 lowest cell temperature degC
+#endif
+#ifndef BOOSTED_ID_FAULT
+#define BOOSTED_ID_FAULT 0x0B57ED13 // u32 fault flags
+#endif
+
+struct BoostedBmsData {
+  float packVoltage;
+  float packCurrent;
+  uint8_t soc;
+  float cellMin;
+  float cellMax;
+  int8_t tempHigh;
+  int8_t tempLow;
+  uint32_t faults;
+  uint32_t lastMs; // millis() of the last decoded frame
+};
+
+/**
+ * @brief      Decode a received frame if it is a BMS frame, called from the CAN receive path
+ * @return     True if the frame belonged to the BMS
+ */
+bool boostedBmsDecode(uint32_t id, bool extd, const uint8_t *data, uint8_t len);
+
+// Latest snapshot, fields keep their last value
+const BoostedBmsData &boostedBms();
+
+// True if BMS frames arrived within BOOSTED_TIMEOUT_MS
+bool boostedBmsValid();
+
+#endif
+
+#endif
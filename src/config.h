@@ -1,6 +1,14 @@
 //****************************************************************************
 //user setup
 
+/*
+Unlock codes, thPercentage, dimmBL, vescSetup, wheelDia, motPol, tachComp, numbCell, battChem, battCap,
+voltdropcomp, showThReading, dashLayout, thComp and stopOnBrake are only the defaults of the first start.
+After that they are changed at runtime: settings page (long press on the dashboard),
+serial ("params", "set wheelDia 250") or http://revolution-dashboard.local/params
+(changes with a POST to /set that carries an unlock code). Values only change while unlocked and standing still.
+*/
+
 #define WIFI_SSID ""  // don't forget to provide your login data inside the quote signs to use over the air programming
 #define WIFI_PASS ""  // programming is only possible at unlocked device, successful connection is displayed under the battery bar
 
@@ -16,21 +24,47 @@ The smoother acceleration in mode 1 is achieved by reducing the max throttle val
 */
 
 const int dimmBL = 200; // 0-255 dimminig rear light when not braking
+const int brakeFade = 0; // ms to fade back to the dimmed rear light when the brake is released, 0 = off
+const int brakeFlash = 0; // number of flashes when the brake light turns on, 0 = off
+
 
+bool vescSetup = 1; // take speed and distance scaling from the motor setup in VESC Tool (firmware 5 and newer)
+                    // it is measured on the first ride and kept until the firmware or the setup changes
 
-//This values are independent from VESC Tool, you have to set it too.
+//This values are used until the VESC setup is known, with vescSetup = 0 or older firmware.
 const int wheelDia = 240; //tyre Size in mm, tune this to get correct velocity (also set the same diameter in the VESC Tool)
 const int motPol = 20;   //motor pole pairs (Boosted Rev = 40 magnets)
 float tachComp = 1.00; // if distance is different to GPS, compensate it with this multiplier
 
 const int numbCell = 12; //number of cells in series of the battery pack
+const int dieBieMS = 0;  //CAN ID of a DieBieMS to read, 0 = no DieBieMS
+const float battCap = 0;  //battery capacity in Ah for coulomb counting, 0 = percentage only from the (sag compensated) voltage
+const int battChem = 0;  //battery cells: 0 = Li-ion NMC, 1 = LiFePO4, 2 = Li-ion Molicel (P42A/P45B)
 
 bool voltdropcomp = 1; /* The trottle reading is very sensitive on the given imput voltage.
 The 5V rail drops when turn on the headlight. This depends on the thin and long wires connected from the VESC to the dashboard.
 1 = Turn on the compensation, this increases the reading of the throttle value. */
 bool showThReading = 0; //Turn this on to have a look at the input reading. This will be displayed above the text "Trip".
+const int dashLayout = 0; // dashboard layout, 0 = classic, 1 = minimal (speed, battery and trip)
 const int thComp = 180; // This schould be the difference of the input reading of the throlle if the headlight is turned on or off.
 
+// throttle curves, index 0 = mode 1, index 1 = mode 2 (the mode 1 cap is thPercentage, mode 2 uses full throttle)
+const int thCurve[2] = {0, 0};     // 0 = linear, 1 = expo (soft around neutral), 2 = S-curve (soft at both ends)
+const int thExpo[2] = {0, 0};      // curve strength 0-100 %
+const int thAccelRate[2] = {0, 0}; // max rise of the throttle per second (0-128 = neutral to full), 0 = unlimited
+const int brakeCurve = 0;          // curve of the brake side, same values as thCurve
+const int brakeExpo = 0;           // curve strength 0-100 %
+const int thDeadband = 0;          // throttle reading around neutral that is ignored
+
+const int thFilterType = 0;    // throttle filter: 0 = Kalman, 1 = critically damped 2nd order, 2 = One-Euro
+const int thFilterMs = 20;     // smoothing time constant in ms, higher = smoother but slower response
+const int thFilterNoise = 4;   // Kalman: noise of the throttle reading (standard deviation in ADC steps)
+const int thFilterSpeed = 2000; // One-Euro: throttle speed (ADC steps per second) that halves the smoothing time
+
+const int telemFastMs = 20;  // poll period of rpm, currents, voltage and distance from the VESC
+const int telemSlowMs = 500; // poll period of temperatures, energy counters and faults
+const int telemPageMs = 100; // poll period of the fields only the visible dashboard page shows (duty, Id/Iq, live temps)
+
 bool stopOnBrake = 1; // 1 = the motors can not accelerate whie using the disc brake, 0 = motors can accelerate while braking
 
 //****************************************************************************
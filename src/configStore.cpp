@@ -0,0 +1,128 @@
+#include "configStore.h"
+#include "crc.h"
+#include <Preferences.h>
+
+struct ConfigHeader {
+  uint16_t version;
+  uint16_t size; // of the data behind the header
+  uint16_t crc;  // of the data
+  uint16_t reserved;
+};
+
+static ConfigData cfg;
+static bool pending = false;
+static uint32_t editMs = 0;
+static size_t loadedSize = 0;
+
+static void setDefaults() {
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.lockMode = 0; // pattern
+}
+
+// settings of firmware before the blob, in their own namespaces
+static void importLegacy() {
+  Preferences pref;
+  if (pref.begin("thValues", true)) {
+    cfg.thMax = pref.getUInt("thMax", 0);
+    cfg.thZero = pref.getUInt("thZero", 0);
+    cfg.thMin = pref.getUInt("thMin", 0);
+    pref.end();
+  }
+  if (pref.begin("lockCfg", true)) {
+    cfg.lockMode = pref.getUInt("lockMode", 0);
+    pref.end();
+  }
+}
+
+// bring data of an older schema up to date, one step per version
+static void migrate(uint16_t from) {
+  switch (from) {
+  case 0:
+    importLegacy();
+    // fall through
+  case 1:
+    // v2 appended the runtime parameters, paramsBegin() sets their defaults
+    // fall through
+  case 2:
+    // v3 appended vescSetup, default from paramsBegin() as well
+    // fall through
+  case 3:
+    // v4 appended dashLayout
+    // fall through, next versions add their steps here
+  default:
+    break;
+  }
+}
+
+void configBegin() {
+  setDefaults();
+
+  uint8_t blob[CONFIG_MAX_BLOB];
+  size_t len = 0;
+  Preferences pref;
+  if (pref.begin("config", true)) {
+    len = pref.getBytesLength("blob");
+    if (len >= sizeof(ConfigHeader) && len <= sizeof(blob))
+      pref.getBytes("blob", blob, len);
+    else
+      len = 0;
+    pref.end();
+  }
+
+  uint16_t version = 0;
+  if (len > 0) {
+    ConfigHeader hdr;
+    memcpy(&hdr, blob, sizeof(hdr));
+    uint8_t *data = blob + sizeof(hdr);
+    if (hdr.size == len - sizeof(hdr) && crc16(data, hdr.size) == hdr.crc) {
+      // fields unknown to an older schema keep their defaults, a newer schema is cut off
+      loadedSize = min((size_t)hdr.size, sizeof(cfg));
+      memcpy(&cfg, data, loadedSize);
+      version = hdr.version;
+    }
+  }
+
+  if (version < CONFIG_VERSION) {
+    migrate(version);
+    pending = true; // store in the current format
+    editMs = millis() - CONFIG_COMMIT_DELAY_MS;
+  }
+}
+
+const ConfigData &config() {
+  return cfg;
+}
+
+ConfigData &configEdit() {
+  pending = true;
+  editMs = millis();
+  return cfg;
+}
+
+size_t configLoadedSize() {
+  return loadedSize;
+}
+
+bool configPending() {
+  return pending;
+}
+
+void configService(uint32_t nowMs) {
+  if (!pending || nowMs - editMs < CONFIG_COMMIT_DELAY_MS)
+    return;
+
+  uint8_t blob[sizeof(ConfigHeader) + sizeof(ConfigData)];
+  ConfigHeader hdr;
+  hdr.version = CONFIG_VERSION;
+  hdr.size = sizeof(ConfigData);
+  hdr.crc = crc16((uint8_t *)&cfg, sizeof(cfg));
+  hdr.reserved = 0;
+  memcpy(blob, &hdr, sizeof(hdr));
+  memcpy(blob + sizeof(hdr), &cfg, sizeof(cfg));
+
+  Preferences pref;
+  pref.begin("config", false);
+  pref.putBytes("blob", blob, sizeof(blob));
+  pref.end();
+  pending = false;
+}
@@ -0,0 +1,64 @@
+#ifndef _CONFIGSTORE_H
+#define _CONFIGSTORE_H
+
+#include <Arduino.h>
+
+/*
+Settings in RAM, stored as one versioned, CRC checked blob in NVS. Reads never touch NVS;
+edits only mark the blob, configService() writes it once edits have settled.
+Older schema versions (and the separate namespaces of earlier firmware) are migrated at boot.
+*/
+
+#define CONFIG_VERSION 4
+#define CONFIG_COMMIT_DELAY_MS 1000 // edits within this time go out in one write
+#define CONFIG_MAX_BLOB 256
+
+// Schema, only append fields and raise CONFIG_VERSION with a migration step
+struct ConfigData {
+  uint32_t thMax;  // throttle calibration
+  uint32_t thZero;
+  uint32_t thMin;
+  uint8_t lockMode;
+
+  // v2: runtime parameters, registered in main.cpp (params.h)
+  int32_t wheelDia;
+  int32_t motPol;
+  float tachComp;
+  int32_t numbCell;
+  int32_t battChem;
+  float battCap;
+  float thPercentage;
+  int32_t thComp;
+  int32_t dimmBL;
+  uint8_t voltdropcomp;
+  uint8_t stopOnBrake;
+  uint8_t showThReading;
+  int32_t mode1;
+  int32_t mode2;
+  int32_t throttleCal;
+
+  // v3
+  uint8_t vescSetup; // speed and distance scaling from the VESC
+
+  // v4
+  int32_t dashLayout;
+};
+
+// Load the blob, migrate older versions
+void configBegin();
+
+const ConfigData &config();
+
+// Bytes of ConfigData found in NVS, fields behind it need their defaults
+size_t configLoadedSize();
+
+// Change settings, the blob is written by configService()
+ConfigData &configEdit();
+
+// True while edits are not written yet
+bool configPending();
+
+// Write pending edits, call from a low priority job
+void configService(uint32_t nowMs);
+
+#endif
@@ -1,6 +1,15 @@
 #include "display.h"
+#include "boostedBms.h"
+#include "configStore.h"
+#include "latency.h"
+#include "layout.h"
+#include "odometer.h"
+#include "params.h"
+#include "rideStats.h"
+#include "sevenSeg.h"
+#include "telemetry.h"
+#include "units.h"
 
-#include "DSEG7.h"
 #include "Esc.h"
 #include "Light.h"
 #include "Mot.h"
@@ -12,30 +21,45 @@ TFT_eSprite mainSprite = TFT_eSprite(&tft);
 
 // Globals from main.cpp (Externs)
 extern bool WIFI;
-extern int batt;
+extern float batt;
 extern int battPerc;
+extern float whKm;
+extern float range;
 extern float trip;
 extern unsigned int throttleRAW;
+extern unsigned int thMax;
+extern unsigned int thZero;
+extern unsigned int thMin;
+extern unsigned int maxVal;
+extern unsigned int minVal;
 extern int escT;
 extern int motT;
 extern bool modeS;
 extern bool lightF;
 extern float speed;
+extern VescComms Vesc;
 
 extern bool lock;
 extern bool confMode;
 extern String entry;
 
-extern bool showThReading; // from config.h (linked)
-
-// Unit Macros (Duplicated from main.cpp or platformio logic)
-#if USE_IMPERIAL_UNITS == 1
-  #define CONVERT_UNIT(v) ((v) * 0.621371)
-  #define UNIT_DIST_STR "mi"
-#else
-  #define CONVERT_UNIT(v) (v)
-  #define UNIT_DIST_STR "km"
+// speed digits, the same size as the former DSEG7 font
+#ifndef SPEED_DIGIT_HEIGHT
+  #define SPEED_DIGIT_HEIGHT 86
+#endif
+#ifndef SPEED_GHOST_COLOR
+  #define SPEED_GHOST_COLOR TFT_BLACK // unlit segments, TFT_BLACK = not shown
 #endif
+typedef SevenSegGeometry<SPEED_DIGIT_HEIGHT> SpeedGeometry;
+static const int speedPitch = SpeedGeometry::width + 10;
+static const int speedX = 79 - (speedPitch + SpeedGeometry::width) / 2;
+static const int speedY = 102 - SpeedGeometry::height / 2;
+static SevenSeg speedDigits(SpeedGeometry::seg, SpeedGeometry::half, SpeedGeometry::width, SpeedGeometry::height,
+                            speedPitch, 2);
+
+// units of the display, speed and trip are converted already
+#define DIST(km) fromKm<DisplayUnits>(km)
+#define UNIT_DIST_STR DisplayUnits::distance()
 
 void initDisplay() {
   tft.init();
@@ -90,34 +114,99 @@ void initDisplay() {
 #endif
   mainSprite.createSprite(170, 320);
   mainSprite.setSwapBytes(true);
+  speedDigits.setColors(TFT_WHITE, SPEED_GHOST_COLOR, TFT_BLACK);
 }
 
 LockMode lockMode = PATTERN;
 
-void drawPatternLock(int x, int y, int mode1, int mode2, int throttleCal) {
-  mainSprite.fillSprite(TFT_BLACK);
+// Lockscreen render state: the static layout is drawn once, afterwards only changed parts are pushed
+static int drawnLockMode = -1; // -1 = layout not on screen
+static int drawnSetting = -1;  // parameter on the settings screen, -1 = not on screen
+static String drawnSettingValue;
+static String drawnEntry = "";
+static int drawnKey = -1;
+
+// Pattern grid config
+static const int patStartX = 35;
+static const int patStartY = 100;
+static const int patSpacing = 50;
+static const int patGridX = 20, patGridY = 85, patGridW = 131, patGridH = 131;
+
+// PIN keypad config
+static const int pinXpos[3] = {3, 58, 113};
+static const int pinYpos[4] = {73, 128, 183, 238};
+static const char pinChars[4][3] = {{'1', '2', '3'}, {'4', '5', '6'}, {'7', '8', '9'}, {' ', '0', ' '}};
+
+// push only a part of the sprite to the display
+static void pushRect(int x, int y, int w, int h) {
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  if (x + w > 170)
+    w = 170 - x;
+  if (y + h > 320)
+    h = 320 - y;
+  if (w > 0 && h > 0)
+    mainSprite.pushSprite(x, y, x, y, w, h);
+}
 
-  // Status Text
+static void drawLockTitle() {
+  drawnSetting = -1;
+  layoutInvalidate();
+  mainSprite.fillSprite(TFT_BLACK);
+  mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
   mainSprite.setTextDatum(4);
   mainSprite.drawString("Locked", 85, 25, 4);
+}
+
+static void patternNodePos(int id, int *x, int *y) {
+  *x = patStartX + ((id - 1) % 3) * patSpacing;
+  *y = patStartY + ((id - 1) / 3) * patSpacing;
+}
+
+static void drawPatternNode(int id, bool active) {
+  int cx, cy;
+  patternNodePos(id, &cx, &cy);
+  if (active) {
+    mainSprite.fillCircle(cx, cy, 8, TFT_WHITE);
+    mainSprite.drawCircle(cx, cy, 12, TFT_WHITE);
+  }
+  else {
+    // Inactive nodes: Thicker and lighter
+    mainSprite.drawCircle(cx, cy, 5, TFT_SILVER);
+    mainSprite.drawCircle(cx, cy, 6, TFT_SILVER);
+  }
+}
 
-  // Grid Config
-  int startX = 35;
-  int startY = 100;
-  int spacing = 50;
+static void drawPatternGrid() {
+  mainSprite.fillRect(patGridX, patGridY, patGridW, patGridH, TFT_BLACK);
+  for (int id = 1; id <= 9; id++) {
+    drawPatternNode(id, false);
+  }
+}
+
+void drawPatternLock(int x, int y, int mode1, int mode2, int throttleCal) {
+  if (drawnLockMode != PATTERN) {
+    drawLockTitle();
+    drawPatternGrid();
+    mainSprite.pushSprite(0, 0);
+    drawnLockMode = PATTERN;
+    drawnEntry = "";
+  }
 
   // Check Touch Input & Update Entry
   int hitNode = 0;
-  for (int r = 0; r < 3; r++) {
-    for (int c = 0; c < 3; c++) {
-      int cx = startX + c * spacing;
-      int cy = startY + r * spacing;
-      int id = r * 3 + c + 1;
-
-      // Check Input radius 20
-      if (x != -1 && abs(x - cx) < 20 && abs(y - cy) < 20) {
-        hitNode = id;
-      }
+  for (int id = 1; id <= 9 && x != -1; id++) {
+    int cx, cy;
+    patternNodePos(id, &cx, &cy);
+    // Check Input radius 20
+    if (abs(x - cx) < 20 && abs(y - cy) < 20) {
+      hitNode = id;
     }
   }
 
@@ -128,46 +217,48 @@ void drawPatternLock(int x, int y, int mode1, int mode2, int throttleCal) {
     }
   }
 
-  // Draw Connections
-  for (int i = 0; i < (int)entry.length() - 1; i++) {
-    int n1 = String(entry.charAt(i)).toInt();
-    int n2 = String(entry.charAt(i + 1)).toInt();
-
-    int r1 = (n1 - 1) / 3;
-    int c1 = (n1 - 1) % 3;
-    int x1 = startX + c1 * spacing;
-    int y1 = startY + r1 * spacing;
-
-    int r2 = (n2 - 1) / 3;
-    int c2 = (n2 - 1) % 3;
-    int x2 = startX + c2 * spacing;
-    int y2 = startY + r2 * spacing;
-
-    // Draw thick line
-    mainSprite.drawLine(x1, y1, x2, y2, TFT_WHITE);
-    mainSprite.drawLine(x1 + 1, y1, x2 + 1, y2, TFT_WHITE);
-    mainSprite.drawLine(x1, y1 + 1, x2, y2 + 1, TFT_WHITE);
+  // Entry was reset (or replaced): clear the grid only
+  if (!entry.startsWith(drawnEntry)) {
+    drawPatternGrid();
+    pushRect(patGridX, patGridY, patGridW, patGridH);
+    drawnEntry = "";
   }
 
-  // Draw Nodes
-  for (int r = 0; r < 3; r++) {
-    for (int c = 0; c < 3; c++) {
-      int cx = startX + c * spacing;
-      int cy = startY + r * spacing;
-      int id = r * 3 + c + 1;
-
-      // Highlight if in entry
-      if (entry.indexOf(String(id)) != -1) {
-        mainSprite.fillCircle(cx, cy, 8, TFT_WHITE);
-        mainSprite.drawCircle(cx, cy, 12, TFT_WHITE);
-      }
-      else {
-        // Inactive nodes: Thicker and lighter
-        mainSprite.drawCircle(cx, cy, 5, TFT_SILVER);
-        mainSprite.drawCircle(cx, cy, 6, TFT_SILVER);
+  // Draw only the newly added nodes and their connection
+  for (unsigned int i = drawnEntry.length(); i < entry.length(); i++) {
+    int n2 = entry.charAt(i) - '0';
+    int x2, y2;
+    patternNodePos(n2, &x2, &y2);
+    int bx1 = x2, by1 = y2, bx2 = x2, by2 = y2;
+
+    if (i > 0) {
+      int n1 = entry.charAt(i - 1) - '0';
+      int x1, y1;
+      patternNodePos(n1, &x1, &y1);
+
+      // Draw thick line
+      mainSprite.drawLine(x1, y1, x2, y2, TFT_WHITE);
+      mainSprite.drawLine(x1 + 1, y1, x2 + 1, y2, TFT_WHITE);
+      mainSprite.drawLine(x1, y1 + 1, x2, y2 + 1, TFT_WHITE);
+
+      bx1 = min(x1, x2);
+      by1 = min(y1, y2);
+      bx2 = max(x1, x2);
+      by2 = max(y1, y2);
+    }
+
+    // Nodes are drawn on top of lines, redraw every node the line passes
+    for (int id = 1; id <= 9; id++) {
+      int cx, cy;
+      patternNodePos(id, &cx, &cy);
+      if (cx >= bx1 && cx <= bx2 && cy >= by1 && cy <= by2) {
+        char c = '0' + id;
+        drawPatternNode(id, entry.substring(0, i + 1).indexOf(c) != -1);
       }
     }
+    pushRect(bx1 - 13, by1 - 13, bx2 - bx1 + 27, by2 - by1 + 27);
   }
+  drawnEntry = entry;
 
   // Check Codes
   if (entry.length() > 0) {
@@ -183,60 +274,75 @@ void drawPatternLock(int x, int y, int mode1, int mode2, int throttleCal) {
       confMode = 1;
     }
   }
+}
 
-  mainSprite.pushSprite(0, 0);
+static void drawPinKey(int i, int j, bool pressed) {
+  int cx = pinXpos[j] + 27;
+  int cy = pinYpos[i] + 27;
+  // 2px wide circle
+  uint16_t color = pressed ? THEME_COLOR : TFT_WHITE;
+  mainSprite.drawCircle(cx, cy, 24, color);
+  mainSprite.drawCircle(cx, cy, 23, color);
 }
 
-void drawPinLock(int x, int y, int mode1, int mode2, int throttleCal) {
-  mainSprite.fillSprite(TFT_BLACK);
+static void drawPinEntry() {
+  mainSprite.fillRect(0, 39, 170, 27, TFT_BLACK);
   mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
   mainSprite.setTextDatum(4);
+  mainSprite.drawString(entry, 85, 52, 4);
+  pushRect(0, 39, 170, 27);
+}
 
-  // Status Text
-  mainSprite.drawString("Locked", 85, 25, 4);
+void drawPinLock(int x, int y, int mode1, int mode2, int throttleCal) {
+  if (drawnLockMode != PIN) {
+    drawLockTitle();
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 3; j++) {
+        if (pinChars[i][j] != ' ') {
+          drawPinKey(i, j, false);
+          mainSprite.drawString(String(pinChars[i][j]), pinXpos[j] + 27, pinYpos[i] + 30, 4);
+        }
+      }
+    }
+    mainSprite.pushSprite(0, 0);
+    drawnLockMode = PIN;
+    drawnEntry = "";
+    drawnKey = -1;
+  }
 
-  int xpos[3] = {3, 58, 113};
-  int ypos[4] = {73, 128, 183, 238};
-  char chars[4][3] = {{'1', '2', '3'}, {'4', '5', '6'}, {'7', '8', '9'}, {' ', '0', ' '}};
   int sx = 10, sy = 10;
-
   for (int i = 0; i < 4; i++) {
-    if (y >= ypos[i] && y <= ypos[i] + 54)
+    if (y >= pinYpos[i] && y <= pinYpos[i] + 54)
       sy = i;
-    for (int j = 0; j < 3; j++) {
-      if (x >= xpos[j] && x <= xpos[j] + 54)
-        sx = j;
-
-      if (chars[i][j] != ' ') {
-        int cx = xpos[j] + 27;
-        int cy = ypos[i] + 27;
-
-        if (sx == j && sy == i) {
-          // Pressed State: 2px wide circle
-          mainSprite.drawCircle(cx, cy, 24, THEME_COLOR);
-          mainSprite.drawCircle(cx, cy, 23, THEME_COLOR);
-        }
-        else {
-          // Normal State: 2px wide circle
-          mainSprite.drawCircle(cx, cy, 24, TFT_WHITE);
-          mainSprite.drawCircle(cx, cy, 23, TFT_WHITE);
-        }
+  }
+  for (int j = 0; j < 3; j++) {
+    if (x >= pinXpos[j] && x <= pinXpos[j] + 54)
+      sx = j;
+  }
 
-        mainSprite.drawString(String(chars[i][j]), cx, cy + 3, 4);
-      }
+  // Update the highlight of the released and the pressed key only
+  int key = (sx < 3 && sy < 4 && pinChars[sy][sx] != ' ') ? sy * 3 + sx : -1;
+  if (key != drawnKey) {
+    if (drawnKey >= 0) {
+      drawPinKey(drawnKey / 3, drawnKey % 3, false);
+      pushRect(pinXpos[drawnKey % 3], pinYpos[drawnKey / 3], 55, 55);
     }
+    if (key >= 0) {
+      drawPinKey(sy, sx, true);
+      pushRect(pinXpos[sx], pinYpos[sy], 55, 55);
+    }
+    drawnKey = key;
   }
 
-  // Mask decorations removed as we simply skip drawing the empty space now
-
   // Process Input if Valid
-  if (sx < 3 && sy < 4) {
-    if (chars[sy][sx] != ' ') {
-      entry += String(chars[sy][sx]);
-    }
+  if (key >= 0) {
+    entry += String(pinChars[sy][sx]);
   }
 
-  mainSprite.drawString(entry, 85, 52, 4);
+  if (entry != drawnEntry) {
+    drawPinEntry();
+    drawnEntry = entry;
+  }
 
   // Check Codes
   if (entry.toInt() == mode1)
@@ -247,43 +353,9 @@ void drawPinLock(int x, int y, int mode1, int mode2, int throttleCal) {
   }
   if (entry.toInt() == throttleCal)
     confMode = 1;
-
-  // Auto-reset if 4 digits and incorrect
-  if (entry.length() >= 4 && lock == 1 && confMode == 0) {
-    mainSprite.pushSprite(0, 0); // Ensure user sees the 4th digit
-    delay(300);
-    entry = "";
-    // Next frame will draw empty
-  }
-  else {
-    mainSprite.pushSprite(0, 0);
-  }
 }
 
 void lockscreen(int x, int y, int mode1, int mode2, int throttleCal) {
-  // Check Toggle (Long Press on "Locked" text)
-  // Area: Centered 85, 25. Width 100, Height 50. => X: 35-135, Y: 0-50
-  static unsigned long btnStart = 0;
-  static bool btnTriggered = false;
-
-  if (x > 35 && x < 135 && y > 0 && y < 50) {
-    if (btnStart == 0) {
-      btnStart = millis();
-      btnTriggered = false;
-    }
-    else {
-      if (millis() - btnStart > 1000 && !btnTriggered) {
-        lockMode = (lockMode == PATTERN) ? PIN : PATTERN;
-        entry = "";
-        btnTriggered = true;
-      }
-    }
-  }
-  else {
-    btnStart = 0;
-    btnTriggered = false;
-  }
-
   if (lockMode == PATTERN) {
     drawPatternLock(x, y, mode1, mode2, throttleCal);
   }
@@ -292,76 +364,428 @@ void lockscreen(int x, int y, int mode1, int mode2, int throttleCal) {
   }
 }
 
-void drawScreen() {
-  // Sprite
+void drawCalibration() {
+  drawnLockMode = -1;
+  drawnSetting = -1;
+  layoutInvalidate();
   mainSprite.fillSprite(TFT_BLACK);
-  mainSprite.unloadFont(); // to draw all other txt before DSEG7 font
-  // WIFI connection
-  mainSprite.setTextColor(THEME_COLOR, TFT_BLACK);
-  mainSprite.setTextDatum(4);
-  if (WIFI == 1)
-    mainSprite.drawString("WIFI connected", 110, 37, 2);
-  // batt bar
   mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
-  if (battPerc > 15) {
-    mainSprite.fillRoundRect(60, 10, battPerc, 15, 2, TFT_GREEN);
-  }
-  else if (battPerc > 0) {
-    mainSprite.fillRoundRect(60, 10, battPerc, 15, 2, TFT_RED);
-  }
-  mainSprite.drawRoundRect(60, 10, 100, 15, 2, TFT_WHITE);
-  // batt txt
-  mainSprite.drawString(String(batt) + "V", 30, 8, 2);
-  mainSprite.drawString(String(battPerc) + "%", 30, 26, 2);
-  // trip txt
+  mainSprite.setTextDatum(4);
+  mainSprite.drawString("move throttle", 85, 20, 2);
+  mainSprite.drawString("a few times from", 85, 40, 2);
+  mainSprite.drawString("full throttle to full brake", 85, 60, 2);
+  mainSprite.drawString("and press OK", 85, 80, 2);
+  mainSprite.drawRoundRect(10, 245, 70, 50, 2, TFT_RED);
+  mainSprite.drawString("X", 45, 272, 4);
+  mainSprite.drawRoundRect(90, 245, 70, 50, 2, TFT_GREEN);
+  mainSprite.drawString("OK", 125, 272, 4);
+
   mainSprite.setTextDatum(0);
-  mainSprite.drawString(String("Trip"), 10, 182, 2);
-  mainSprite.setTextDatum(2);
-  mainSprite.drawString(String(CONVERT_UNIT(trip), 2) + UNIT_DIST_STR, 160, 175, 4);
-  // show throttle reading
-  if (showThReading == 1) {
-    mainSprite.setTextDatum(0);
-    mainSprite.drawString(String(throttleRAW), 10, 162, 2);
-  }
-  // line
-  mainSprite.drawLine(0, 210, 170, 210, TFT_DARKGREY);
-  // ESCTemp txt
-  mainSprite.setTextDatum(2);
-  mainSprite.drawString(String(escT), 40, 290, 4);
-  mainSprite.drawCircle(46, 293, 3, TFT_WHITE);
-  mainSprite.pushImage(10, 230, 40, 40, Esc);
-  // motTemp txt
+  mainSprite.drawString("old Value", 5, 110, 2);
+  mainSprite.drawString(String(thMax), 5, 130, 4);
+  mainSprite.drawString(String(thZero), 5, 160, 4);
+  mainSprite.drawString(String(thMin), 5, 190, 4);
+
   mainSprite.setTextDatum(2);
-  mainSprite.drawString(String(motT), 152, 290, 4);
-  mainSprite.drawCircle(158, 293, 3, TFT_WHITE);
-  mainSprite.pushImage(120, 230, 40, 40, Mot);
-  // mode
-  if (modeS == 1) {
-    mainSprite.drawRoundRect(75, 286, 22, 27, 3, TFT_RED);
-  }
-  else {
-    mainSprite.drawRoundRect(75, 286, 22, 27, 5, TFT_DARKGREY);
+  mainSprite.drawString("new Value", 165, 110, 2);
+  mainSprite.drawString(String(maxVal), 165, 130, 4);
+  mainSprite.drawString(String(throttleRAW), 165, 160, 4);
+  mainSprite.drawString(String(minVal), 165, 190, 4);
+
+  mainSprite.pushSprite(0, 0);
+}
+
+static String durationText(uint32_t s) {
+  char buf[12];
+  snprintf(buf, sizeof(buf), "%u:%02u:%02u", s / 3600, s / 60 % 60, s % 60);
+  return String(buf);
+}
+
+bool drawSettings(uint8_t index) {
+  String value = paramText(index);
+  if (index == drawnSetting && value == drawnSettingValue)
+    return false;
+  drawnSettingValue = value;
+  if (index == drawnSetting) {
+    // only the value changed
+    mainSprite.fillRect(0, 157, 170, 26, TFT_BLACK);
+    mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
+    mainSprite.setTextDatum(4);
+    mainSprite.drawString(value, 85, 170, 4);
+    pushRect(0, 157, 170, 26);
+    return true;
   }
+  drawnSetting = index;
+  drawnLockMode = -1;
+  layoutInvalidate();
+  const ParamDef &p = paramDef(index);
+
+  mainSprite.fillSprite(TFT_BLACK);
+  mainSprite.setTextColor(THEME_COLOR, TFT_BLACK);
   mainSprite.setTextDatum(4);
-  mainSprite.drawString(String("S"), 86, 299, 2);
-  // light
-  mainSprite.pushImage(65, 230, 40, 40, Light);
-  if (lightF == 1) {
-    mainSprite.drawRoundRect(62, 229, 46, 41, 3, THEME_COLOR);
-  }
-  else {
-    mainSprite.drawRoundRect(62, 229, 46, 41, 5, TFT_DARKGREY);
+  mainSprite.drawString("Settings", 85, 15, 4);
+  mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
+  mainSprite.drawString(String(index + 1) + "/" + String(paramCount()), 85, 40, 2);
+  // previous / next parameter
+  mainSprite.drawRoundRect(10, 60, 50, 50, 2, TFT_WHITE);
+  mainSprite.drawString("<", 35, 87, 4);
+  mainSprite.drawRoundRect(110, 60, 50, 50, 2, TFT_WHITE);
+  mainSprite.drawString(">", 135, 87, 4);
+
+  mainSprite.drawString(p.name, 85, 135, 2);
+  mainSprite.drawString(value, 85, 170, 4);
+  mainSprite.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  if (!(p.flags & PARAM_SECRET))
+    mainSprite.drawString(String(p.min, 2) + " .. " + String(p.max, 2), 85, 205, 2);
+  mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
+
+  // change value
+  mainSprite.drawRoundRect(10, 245, 70, 50, 2, TFT_RED);
+  mainSprite.drawString("-", 45, 272, 4);
+  mainSprite.drawRoundRect(90, 245, 70, 50, 2, TFT_GREEN);
+  mainSprite.drawString("+", 125, 272, 4);
+  mainSprite.pushSprite(0, 0);
+  return true;
+}
+
+// Dashboard widgets: value sources quantised to the shown resolution and their formatters
+static int32_t wifiValue() { return WIFI; }
+static int32_t battVValue() { return (int)batt; }
+static int32_t battPercValue() { return battPerc; }
+// 0.01 units, rounded like String(trip, 2); fewer decimals from 100 and 1000 on, see tripText()
+static int32_t tripValue() {
+  if (trip < 99.995f)
+    return lroundf(trip * 100);
+  if (trip < 999.95f)
+    return lroundf(trip * 10) * 10;
+  return lroundf(trip) * 100;
+}
+static int32_t rangeValue() { return range >= 0 ? lroundf(DIST(range)) : -1; }
+static int32_t whKmValue() { return whKm > 0 ? lroundf(whKm / DIST(1.0)) : WIDGET_HIDDEN; }
+static int32_t throttleValue() { return config().showThReading == 1 ? (int32_t)throttleRAW : WIDGET_HIDDEN; }
+static int32_t escTValue() { return escT; }
+static int32_t motTValue() { return motT; }
+static int32_t modeValue() { return modeS; }
+static int32_t lightValue() { return lightF; }
+
+static int32_t speedValue() {
+  int dispSpeed = speed < 0 ? -1 : (int)(speed + 0.5);
+  return dispSpeed > 99 ? 99 : dispSpeed;
+}
+
+static String numberText(int32_t v) { return String(v); }
+static String voltText(int32_t v) { return String(v) + "V"; }
+static String percentText(int32_t v) { return String(v) + "%"; }
+// 4 digits and a point below 10000, "99.99km" to "99999km" in font 4 fit the 110 px of the widget
+static String tripText(int32_t v) { return String(v / 100.0, v < 10000 ? 2 : v < 100000 ? 1 : 0) + UNIT_DIST_STR; }
+static String rangeText(int32_t v) { return (v < 0 ? String("--") : String(v)) + UNIT_DIST_STR; }
+static String whKmText(int32_t v) { return String(v) + "Wh/" + UNIT_DIST_STR; }
+
+#if LATENCY_TRACE
+// throttle ADC value to command sent in 0.1 ms
+struct LatencyShown {
+  uint32_t p50, p99, max;
+};
+static LatencyShown latencyShown;
+static int32_t latencyChanges = 0;
+
+// counts the changes of the shown values, they do not fit one int32 together
+static int32_t latencyValue() {
+  LatencyShown now = {latencyPercentile(LAT_TX_DONE, 50) / 100, latencyPercentile(LAT_TX_DONE, 99) / 100,
+                      latencyMax(LAT_TX_DONE) / 100};
+  if (now.p50 != latencyShown.p50 || now.p99 != latencyShown.p99 || now.max != latencyShown.max) {
+    latencyShown = now;
+    latencyChanges++;
   }
-  // speed
-  mainSprite.setTextDatum(4);
-  mainSprite.loadFont(DSEG7);
-  float dispSpeed = CONVERT_UNIT(speed);
-  if (dispSpeed < 0) {
-    dispSpeed = 0;
+  return latencyChanges;
+}
+
+static String latencyText(int32_t) {
+  return "lat " + String(latencyShown.p50 / 10.0, 1) + "/" + String(latencyShown.p99 / 10.0, 1) + "/" +
+         String(latencyShown.max / 10.0, 1) + "ms";
+}
+#endif
+
+static const int speedW = speedPitch + SpeedGeometry::width;
+
+static const Widget classicWidgets[] = {
+    // battery and WIFI connection
+    BAR_WIDGET(60, 10, 100, 15, battPercValue, TFT_GREEN, TFT_RED, 15),
+    TEXT_WIDGET(0, 0, 60, 16, battVValue, voltText, 2, MC_DATUM, TFT_WHITE),
+    TEXT_WIDGET(0, 18, 60, 16, battPercValue, percentText, 2, MC_DATUM, TFT_WHITE),
+    LABEL_WIDGET(60, 29, 100, 16, wifiValue, "WIFI connected", 2, MC_DATUM, THEME_COLOR),
+    // speed
+    DIGITS_WIDGET(speedX, speedY, speedW, SpeedGeometry::height, speedValue, &speedDigits),
+    // range, energy use, throttle reading and trip
+#if LATENCY_TRACE
+    TEXT_WIDGET(10, 145, 80, 9, latencyValue, latencyText, 1, TL_DATUM, TFT_WHITE),
+#endif
+    TEXT_WIDGET(90, 145, 70, 15, rangeValue, rangeText, 2, TR_DATUM, TFT_WHITE),
+    TEXT_WIDGET(90, 160, 70, 9, whKmValue, whKmText, 1, TR_DATUM, TFT_WHITE),
+    TEXT_WIDGET(10, 162, 40, 16, throttleValue, numberText, 2, TL_DATUM, TFT_WHITE),
+    LABEL_WIDGET(10, 182, 40, 16, NULL, "Trip", 2, TL_DATUM, TFT_WHITE),
+    TEXT_WIDGET(50, 175, 110, 26, tripValue, tripText, 4, TR_DATUM, TFT_WHITE),
+    LINE_WIDGET(0, 210, 170, 210, TFT_DARKGREY),
+    // ESC and motor temperature
+    IMAGE_WIDGET(10, 230, 40, 40, Esc),
+    TEXT_WIDGET(0, 290, 40, 26, escTValue, numberText, 4, TR_DATUM, TFT_WHITE),
+    CIRCLE_WIDGET(46, 293, 3, TFT_WHITE),
+    IMAGE_WIDGET(120, 230, 40, 40, Mot),
+    TEXT_WIDGET(110, 290, 42, 26, motTValue, numberText, 4, TR_DATUM, TFT_WHITE),
+    CIRCLE_WIDGET(158, 293, 3, TFT_WHITE),
+    // sport mode and light, the touch areas of ui.cpp
+    BOX_WIDGET(75, 286, 22, 27, modeValue, "S", NULL, TFT_RED, TFT_DARKGREY),
+    BOX_WIDGET(62, 229, 46, 41, lightValue, NULL, Light, THEME_COLOR, TFT_DARKGREY),
+};
+
+// speed, battery and trip only
+static const Widget minimalWidgets[] = {
+    BAR_WIDGET(10, 10, 150, 20, battPercValue, TFT_GREEN, TFT_RED, 15),
+    TEXT_WIDGET(35, 34, 100, 16, battPercValue, percentText, 2, MC_DATUM, TFT_WHITE),
+    DIGITS_WIDGET(speedX, speedY, speedW, SpeedGeometry::height, speedValue, &speedDigits),
+    LABEL_WIDGET(35, 148, 100, 16, NULL, DisplayUnits::speed(), 2, MC_DATUM, TFT_DARKGREY),
+    TEXT_WIDGET(10, 172, 150, 26, tripValue, tripText, 4, MC_DATUM, TFT_WHITE),
+    LINE_WIDGET(0, 210, 170, 210, TFT_DARKGREY),
+    BOX_WIDGET(75, 286, 22, 27, modeValue, "S", NULL, TFT_RED, TFT_DARKGREY),
+    BOX_WIDGET(62, 229, 46, 41, lightValue, NULL, Light, THEME_COLOR, TFT_DARKGREY),
+};
+
+static const Layout dashLayouts[] = {
+    LAYOUT("classic", classicWidgets),
+    LAYOUT("minimal", minimalWidgets),
+};
+static const Layout *dashLayout = &dashLayouts[0];
+
+uint8_t dashboardLayoutCount() {
+  return sizeof(dashLayouts) / sizeof(dashLayouts[0]);
+}
+
+void setDashboardLayout(uint8_t index) {
+  dashLayout = &dashLayouts[index < dashboardLayoutCount() ? index : 0];
+}
+
+static bool drawLayout(const Layout *layout) {
+  layoutSelect(layout);
+  bool changed = layoutDraw(mainSprite, tft);
+  if (changed) {
+    drawnLockMode = -1; // sprite gets overwritten, lockscreen and settings have to redraw their layout
+    drawnSetting = -1;
   }
-  else {
-    mainSprite.drawString(String(dispSpeed, 0), 79, 102, 8);
+  return changed;
+}
+
+bool drawScreen() {
+  return drawLayout(dashLayout);
+}
+
+// Detail pages: a title and rows of a label with a value below
+#define PAGE_TITLE(text) LABEL_WIDGET(0, 0, 170, 32, NULL, text, 4, MC_DATUM, THEME_COLOR)
+#define ROW_Y(row) (40 + (row) * 46)
+#define ROW_LABEL(row, text) LABEL_WIDGET(5, ROW_Y(row), 160, 16, NULL, text, 2, TL_DATUM, TFT_DARKGREY)
+#define ROW_VALUE(row, value, format) TEXT_WIDGET(5, ROW_Y(row) + 16, 160, 26, value, format, 4, TR_DATUM, TFT_WHITE)
+
+static int32_t motorAValue() { return lroundf(Vesc.data.avgMotorCurrent * 10); }
+static int32_t battAValue() { return lroundf(Vesc.data.avgInputCurrent * 10); }
+static int32_t powerValue() { return lroundf(batt * Vesc.data.avgInputCurrent); }
+static int32_t dutyValue() { return lroundf(Vesc.data.dutyCycleNow * 100); }
+static int32_t idValue() { return lroundf(Vesc.data.avgIdCurent * 10); }
+static int32_t iqValue() { return lroundf(Vesc.data.avgIqCurent * 10); }
+static int32_t faultValue() { return Vesc.data.fault; }
+static int32_t voltValue() { return lroundf(batt * 10); }
+static int32_t ahUsedValue() { return lroundf(Vesc.data.ampHours * 100); }
+static int32_t ahChargedValue() { return lroundf(Vesc.data.ampHoursCharged * 100); }
+static int32_t whNetValue() { return lroundf((Vesc.data.watt_hours - Vesc.data.watt_hours_charged) * 10); }
+static int32_t busRateValue() { return telemetryBusRate(); }
+static int32_t heapValue() { return ESP.getFreeHeap() / 1024; }
+
+// lowest and highest cell in mV as low * 10000 + high, from the BMS that is sending
+static int32_t cellsValue() {
+#if BOOSTED_BMS_DECODER
+  if (boostedBmsValid())
+    return lroundf(boostedBms().cellMin * 1000) * 10000 + lroundf(boostedBms().cellMax * 1000);
+#endif
+  if (Vesc.DieBieMSlastMs != 0 && millis() - Vesc.DieBieMSlastMs < BOOSTED_TIMEOUT_MS)
+    return lroundf(Vesc.DieBieMSdata.cellVoltageLow * 1000) * 10000 + lroundf(Vesc.DieBieMSdata.cellVoltageHigh * 1000);
+  return WIDGET_HIDDEN;
+}
+
+static int32_t bmsTempValue() {
+#if BOOSTED_BMS_DECODER
+  if (boostedBmsValid())
+    return boostedBms().tempHigh;
+#endif
+  if (Vesc.DieBieMSlastMs != 0 && millis() - Vesc.DieBieMSlastMs < BOOSTED_TIMEOUT_MS)
+    return lroundf(Vesc.DieBieMSdata.tempBatteryHigh);
+  return WIDGET_HIDDEN;
+}
+
+// summary of the current ride, computed at most every 100 ms for all widgets of a frame
+static const RideSummary &ride() {
+  static RideSummary r;
+  static uint32_t at = 0;
+  static bool valid = false;
+  uint32_t now = millis();
+  if (!valid || now - at >= 100) {
+    rideStatsSummary(&r);
+    at = now;
+    valid = true;
   }
-  // push Sprite to disp
-  mainSprite.pushSprite(0, 0);
+  return r;
+}
+
+// ride maxima, ESC in the high byte, motor in the low one
+static int32_t maxTempValue() {
+  return (uint8_t)ride().maxTempFet << 8 | (uint8_t)ride().maxTempMotor;
+}
+
+static String tenthsText(int32_t v, const char *unit) { return String(v / 10.0, 1) + unit; }
+static String ampText(int32_t v) { return tenthsText(v, "A"); }
+static String voltTenthsText(int32_t v) { return tenthsText(v, "V"); }
+static String whText(int32_t v) { return tenthsText(v, "Wh"); }
+static String wattText(int32_t v) { return String(v) + "W"; }
+static String ahText(int32_t v) { return String(v / 100.0, 2) + "Ah"; }
+static String tempText(int32_t v) { return String(v) + "C"; }
+static String maxTempPart(int8_t t) { return t == RIDE_TEMP_NONE ? String("--") : String(t); }
+static String maxTempText(int32_t v) { return maxTempPart((int8_t)(v >> 8)) + "/" + maxTempPart((int8_t)(v & 0xFF)) + "C"; }
+static String cellsText(int32_t v) { return String(v / 10000 / 1000.0, 2) + "-" + String(v % 10000 / 1000.0, 2) + "V"; }
+static String busRateText(int32_t v) { return String(v) + "B/s"; }
+static String heapText(int32_t v) { return String(v) + "kB"; }
+static String faultText(int32_t v) { return v == FAULT_CODE_NONE ? String("none") : String(v); }
+
+static const Widget powerWidgets[] = {
+    PAGE_TITLE("Power"),
+    ROW_LABEL(0, "Motor current"),  ROW_VALUE(0, motorAValue, ampText),
+    ROW_LABEL(1, "Battery current"), ROW_VALUE(1, battAValue, ampText),
+    ROW_LABEL(2, "Power"),          ROW_VALUE(2, powerValue, wattText),
+    ROW_LABEL(3, "Duty cycle"),     ROW_VALUE(3, dutyValue, percentText),
+};
+
+static const Widget batteryWidgets[] = {
+    PAGE_TITLE("Battery"),
+    ROW_LABEL(0, "Voltage"),      ROW_VALUE(0, voltValue, voltTenthsText),
+    ROW_LABEL(1, "Charge"),       ROW_VALUE(1, battPercValue, percentText),
+    ROW_LABEL(2, "Used"),         ROW_VALUE(2, ahUsedValue, ahText),
+    ROW_LABEL(3, "Charged"),      ROW_VALUE(3, ahChargedValue, ahText),
+    ROW_LABEL(4, "Energy"),       ROW_VALUE(4, whNetValue, whText),
+    ROW_LABEL(5, "Cells (BMS)"),  ROW_VALUE(5, cellsValue, cellsText),
+};
+
+static const Widget tempWidgets[] = {
+    PAGE_TITLE("Temperatures"),
+    ROW_LABEL(0, "ESC"),          ROW_VALUE(0, escTValue, tempText),
+    ROW_LABEL(1, "Motor"),        ROW_VALUE(1, motTValue, tempText),
+    ROW_LABEL(2, "Max ESC/Mot"),  ROW_VALUE(2, maxTempValue, maxTempText),
+    ROW_LABEL(3, "Battery (BMS)"), ROW_VALUE(3, bmsTempValue, tempText),
+};
+
+static const Widget diagWidgets[] = {
+    PAGE_TITLE("Diagnostics"),
+    ROW_LABEL(0, "Fault"),        ROW_VALUE(0, faultValue, faultText),
+    ROW_LABEL(1, "Duty cycle"),   ROW_VALUE(1, dutyValue, percentText),
+    ROW_LABEL(2, "Id"),           ROW_VALUE(2, idValue, ampText),
+    ROW_LABEL(3, "Iq"),           ROW_VALUE(3, iqValue, ampText),
+    ROW_LABEL(4, "Bus"),          ROW_VALUE(4, busRateValue, busRateText),
+    ROW_LABEL(5, "Free heap"),    ROW_VALUE(5, heapValue, heapText),
+};
+
+// Ride statistics: label and value on one row
+#define STAT_Y(row) (40 + (row) * 19)
+#define STAT_LABEL(row, text) LABEL_WIDGET(5, STAT_Y(row), 80, 16, NULL, text, 2, TL_DATUM, TFT_WHITE)
+#define STAT_VALUE(row, value, format) TEXT_WIDGET(85, STAT_Y(row), 80, 16, value, format, 2, TR_DATUM, TFT_WHITE)
+
+static int32_t rideTimeValue() { return ride().rideS; }
+static int32_t movingTimeValue() { return ride().movingS; }
+static int32_t rideDistValue() { return lroundf(DIST(ride().distM / 1000.0) * 100); }
+static int32_t maxSpeedValue() { return lroundf(DIST(ride().maxSpeed / 10.0) * 10); }
+static int32_t avgSpeedValue() { // average * 10000 + deviation, 0.1 units
+  return lroundf(DIST(ride().avgSpeed / 10.0) * 10) * 10000 + lroundf(DIST(ride().speedSd / 10.0) * 10);
+}
+static int32_t whUsedValue() { return ride().whUsed; }
+static int32_t whRegenValue() { return ride().whRegen; }
+static int32_t peakMotorValue() { return ride().peakMotorA; }
+static int32_t peakBattValue() { return (int32_t)((uint32_t)(uint16_t)ride().peakBattA << 16 | (uint16_t)ride().peakRegenA); }
+static int32_t maxPowerValue() { return ride().maxPowerW; }
+static int32_t odometerValue() { return lroundf(DIST(odometerMeters() / 1000)); }
+
+// last stored ride as 0.1 distance units * 100000 + seconds
+static int32_t lastRideValue() {
+  RideSummary last;
+  if (!rideStatsLast(&last))
+    return WIDGET_HIDDEN;
+  return lroundf(DIST(last.distM / 1000.0) * 10) * 100000 + min(last.rideS, (uint32_t)99999);
+}
+
+static String durationValueText(int32_t v) { return durationText(v); }
+static String distText(int32_t v) { return String(v / 100.0, 2) + UNIT_DIST_STR; }
+static String speedText(int32_t v) { return tenthsText(v, DisplayUnits::speed()); }
+static String avgSpeedText(int32_t v) { return String(v / 10000 / 10.0, 1) + " +-" + String(v % 10000 / 10.0, 1); }
+static String wholeAmpText(int32_t v) { return String(v) + "A"; }
+static String peakBattText(int32_t v) { return String((int16_t)(v >> 16)) + "/" + String((int16_t)(v & 0xFFFF)) + "A"; }
+static String wholeDistText(int32_t v) { return String(v) + UNIT_DIST_STR; }
+static String lastRideText(int32_t v) {
+  return String(v / 100000 / 10.0, 1) + UNIT_DIST_STR + " " + durationText(v % 100000);
+}
+
+static const Widget statsWidgets[] = {
+    LABEL_WIDGET(0, 0, 170, 30, NULL, "Ride", 4, MC_DATUM, THEME_COLOR),
+    STAT_LABEL(0, "Time"),                     STAT_VALUE(0, rideTimeValue, durationValueText),
+    STAT_LABEL(1, "Moving"),                   STAT_VALUE(1, movingTimeValue, durationValueText),
+    STAT_LABEL(2, "Distance"),                 STAT_VALUE(2, rideDistValue, distText),
+    STAT_LABEL(3, "Max speed"),                STAT_VALUE(3, maxSpeedValue, speedText),
+    STAT_LABEL(4, "Avg speed"),                STAT_VALUE(4, avgSpeedValue, avgSpeedText),
+    STAT_LABEL(5, "Energy"),                   STAT_VALUE(5, whUsedValue, whText),
+    STAT_LABEL(6, "Regen"),                    STAT_VALUE(6, whRegenValue, whText),
+    STAT_LABEL(7, "Peak motor"),               STAT_VALUE(7, peakMotorValue, wholeAmpText),
+    STAT_LABEL(8, "Peak battery"),             STAT_VALUE(8, peakBattValue, peakBattText),
+    STAT_LABEL(9, "Max power"),                STAT_VALUE(9, maxPowerValue, wattText),
+    STAT_LABEL(10, "Max ESC/Mot"),             STAT_VALUE(10, maxTempValue, maxTempText),
+    STAT_LABEL(11, "Odometer"),                STAT_VALUE(11, odometerValue, wholeDistText),
+    LINE_WIDGET(0, 272, 170, 272, TFT_DARKGREY),
+    // the last ride is fixed after the start, it only appears or not
+    LABEL_WIDGET(5, STAT_Y(13), 60, 16, lastRideValue, "Last ride", 2, TL_DATUM, TFT_DARKGREY),
+    TEXT_WIDGET(65, STAT_Y(13), 100, 16, lastRideValue, lastRideText, 2, TR_DATUM, TFT_DARKGREY),
+};
+
+static const Layout powerLayout = LAYOUT("power", powerWidgets);
+static const Layout batteryLayout = LAYOUT("battery", batteryWidgets);
+static const Layout tempLayout = LAYOUT("temps", tempWidgets);
+static const Layout diagLayout = LAYOUT("diagnostics", diagWidgets);
+static const Layout statsLayout = LAYOUT("stats", statsWidgets);
+
+static bool drawPowerPage() { return drawLayout(&powerLayout); }
+static bool drawBatteryPage() { return drawLayout(&batteryLayout); }
+static bool drawTempPage() { return drawLayout(&tempLayout); }
+static bool drawDiagPage() { return drawLayout(&diagLayout); }
+static bool drawStatsPage() { return drawLayout(&statsLayout); }
+
+// Swipe order; the fast and slow telemetry classes are always polled, pages add what only they show
+struct DashPage {
+  const char *name;
+  bool (*draw)();
+  uint32_t telemetry;
+};
+
+static const DashPage pages[] = {
+    {"main", drawScreen, 0},
+    {"power", drawPowerPage, TELEM_DUTY},
+    {"battery", drawBatteryPage, TELEM_AH | TELEM_AH_CHARGED | TELEM_WH | TELEM_WH_CHARGED | TELEM_TACHO_ABS},
+    {"temps", drawTempPage, TELEM_TEMP_FET | TELEM_TEMP_MOTOR},
+    {"stats", drawStatsPage, 0},
+    {"diagnostics", drawDiagPage, TELEM_FAULT | TELEM_DUTY | TELEM_ID_CURRENT | TELEM_IQ_CURRENT},
+};
+
+uint8_t pageCount() {
+  return sizeof(pages) / sizeof(pages[0]);
+}
+
+const char *pageName(uint8_t index) {
+  return pages[index < pageCount() ? index : 0].name;
+}
+
+uint32_t pageTelemetry(uint8_t index) {
+  return pages[index < pageCount() ? index : 0].telemetry;
+}
+
+bool drawPage(uint8_t index) {
+  return pages[index < pageCount() ? index : 0].draw();
 }
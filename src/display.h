@@ -7,8 +7,28 @@
 // Initialize Display (TFT, Sprite, Boot Image)
 void initDisplay();
 
-// Draw the main dashboard screen
-void drawScreen();
+// Draw the main dashboard screen, false if nothing changed since the last frame
+bool drawScreen();
+
+// Select the dashboard layout, unknown indices fall back to the first one
+void setDashboardLayout(uint8_t index);
+uint8_t dashboardLayoutCount();
+
+// Dashboard pages in swipe order, the first one is the main screen
+uint8_t pageCount();
+const char *pageName(uint8_t index);
+
+// Telemetry fields (telemetry.h mask bits) only this page shows
+uint32_t pageTelemetry(uint8_t index);
+
+// Draw a page, false if nothing changed since the last frame
+bool drawPage(uint8_t index);
+
+// Draw the settings screen for one runtime parameter, false if it is on screen already
+bool drawSettings(uint8_t index);
+
+// Draw the throttle calibration screen
+void drawCalibration();
 
 // Draw the lockscreen
 void lockscreen(int x, int y, int mode1, int mode2, int throttleCal);
@@ -0,0 +1,70 @@
+#include "latency.h"
+
+#if LATENCY_TRACE
+
+struct LatencyHist {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t max;
+};
+
+static const char *pointNames[LAT_POINTS] = {"adc", "filter", "command", "enqueue", "tx done"};
+static LatencyHist hist[LAT_POINTS];
+static uint32_t startUs = 0;
+static uint8_t armed = 0; // stages not yet recorded for the current ADC value
+
+void latencyMark(LatencyPoint point, uint32_t timeUs) {
+  if (point == LAT_ADC) {
+    startUs = timeUs;
+    armed = ((1 << LAT_POINTS) - 1) & ~(1 << LAT_ADC);
+    return;
+  }
+  if (!(armed & (1 << point)))
+    return;
+  armed &= ~(1 << point);
+
+  uint32_t us = timeUs - startUs;
+  uint32_t b = us / LATENCY_BUCKET_US;
+  LatencyHist &h = hist[point];
+  h.buckets[b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1]++;
+  h.count++;
+  if (us > h.max)
+    h.max = us;
+}
+
+bool latencyTxPending() {
+  return (armed & (1 << LAT_TX_DONE)) && !(armed & (1 << LAT_ENQUEUE));
+}
+
+uint32_t latencyPercentile(LatencyPoint point, uint8_t pct) {
+  const LatencyHist &h = hist[point];
+  if (h.count == 0)
+    return 0;
+  uint32_t target = ((uint64_t)h.count * pct + 99) / 100;
+  uint32_t sum = 0;
+  for (int b = 0; b < LATENCY_BUCKETS; b++) {
+    sum += h.buckets[b];
+    if (sum >= target)
+      return b < LATENCY_BUCKETS - 1 ? (b + 1) * LATENCY_BUCKET_US : h.max;
+  }
+  return h.max;
+}
+
+uint32_t latencyMax(LatencyPoint point) {
+  return hist[point].max;
+}
+
+void latencyReport(Print &out) {
+  out.println("latency from ADC value [us]: p50 / p99 / max (n)");
+  for (int p = LAT_FILTER; p < LAT_POINTS; p++) {
+    out.printf("%-8s %6u / %6u / %6u (%u)\n", pointNames[p], latencyPercentile((LatencyPoint)p, 50),
+               latencyPercentile((LatencyPoint)p, 99), hist[p].max, hist[p].count);
+  }
+}
+
+void latencyReset() {
+  memset(hist, 0, sizeof(hist));
+  armed = 0;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <Arduino.h>
+
+/*
+Throttle-to-bus latency instrumentation. Every stage is measured from the time the ADC value
+was completed, into fixed-bucket histograms. Enable with -D LATENCY_TRACE=1, otherwise the
+marks compile to nothing.
+*/
+
+#ifndef LATENCY_TRACE
+  #define LATENCY_TRACE 0
+#endif
+
+#define LATENCY_BUCKETS 64
+#define LATENCY_BUCKET_US 250 // 64 x 250us = 16ms, the last bucket collects everything above
+
+enum LatencyPoint {
+  LAT_ADC = 0, // decimated ADC value completed
+  LAT_FILTER,  // filter output
+  LAT_COMMAND, // nunchuck value built
+  LAT_ENQUEUE, // command handed to TWAI / UART
+  LAT_TX_DONE, // command left the controller
+  LAT_POINTS
+};
+
+#if LATENCY_TRACE
+  #define LATENCY_MARK(p, t) latencyMark(p, t)
+
+// Record a stage of the current command
+void latencyMark(LatencyPoint point, uint32_t timeUs);
+
+// Waiting for the TX-complete mark
+bool latencyTxPending();
+
+// Percentile of a stage in us (upper bucket bound), pct 0-100
+uint32_t latencyPercentile(LatencyPoint point, uint8_t pct);
+uint32_t latencyMax(LatencyPoint point);
+
+// Print p50/p99/max of all stages
+void latencyReport(Print &out);
+void latencyReset();
+#else
+  #define LATENCY_MARK(p, t)
+#endif
+
+#endif
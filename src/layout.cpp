@@ -0,0 +1,181 @@
+#include "layout.h"
+
+static const Layout *current = NULL;
+static bool valid = false;
+static int32_t drawn[LAYOUT_MAX_WIDGETS]; // last drawn value of each widget
+
+// static widgets of a layout, rendered once into PSRAM
+struct StaticLayer {
+  const Layout *layout;
+  TFT_eSprite *sprite;
+};
+static StaticLayer layers[LAYOUT_CACHE_LAYERS];
+static uint8_t layerCount = 0;
+
+void layoutSelect(const Layout *layout) {
+  if (layout != current) {
+    current = layout;
+    valid = false;
+  }
+}
+
+const Layout *layoutCurrent() {
+  return current;
+}
+
+void layoutInvalidate() {
+  valid = false;
+}
+
+// text anchor inside the rectangle
+static void anchor(const Widget &w, int *x, int *y) {
+  switch (w.datum) {
+  case TR_DATUM:
+    *x = w.x + w.w;
+    *y = w.y;
+    break;
+  case MC_DATUM:
+    *x = w.x + w.w / 2;
+    *y = w.y + w.h / 2;
+    break;
+  default:
+    *x = w.x;
+    *y = w.y;
+    break;
+  }
+}
+
+static void paint(TFT_eSprite &spr, const Widget &w, int32_t v) {
+  int x, y;
+  switch (w.kind) {
+  case WIDGET_TEXT:
+    if (v == WIDGET_HIDDEN || (!w.format && w.value && !v))
+      break;
+    anchor(w, &x, &y);
+    spr.setTextColor(w.color, TFT_BLACK);
+    spr.setTextDatum(w.datum);
+    spr.drawString(w.format ? w.format(v) : String(w.label), x, y, w.font);
+    break;
+  case WIDGET_BAR:
+    if (v > 0) {
+      int fill = (int)(constrain(v, 0, 100) * w.w / 100);
+      spr.fillRoundRect(w.x, w.y, fill, w.h, 2, v > w.threshold ? w.color : w.colorAlt);
+    }
+    spr.drawRoundRect(w.x, w.y, w.w, w.h, 2, TFT_WHITE);
+    break;
+  case WIDGET_BOX:
+    if (w.image)
+      spr.pushImage(w.x + (w.w - 40) / 2, w.y + 1, 40, 40, w.image);
+    if (w.label) {
+      anchor(w, &x, &y);
+      spr.setTextColor(TFT_WHITE, TFT_BLACK);
+      spr.setTextDatum(w.datum);
+      spr.drawString(w.label, x, y, w.font);
+    }
+    if (v)
+      spr.drawRoundRect(w.x, w.y, w.w, w.h, 3, w.color);
+    else
+      spr.drawRoundRect(w.x, w.y, w.w, w.h, 5, w.colorAlt);
+    break;
+  case WIDGET_IMAGE:
+    spr.pushImage(w.x, w.y, w.w, w.h, w.image);
+    break;
+  case WIDGET_LINE:
+    spr.drawLine(w.x, w.y, w.x + w.w, w.y + w.h, w.color);
+    break;
+  case WIDGET_CIRCLE:
+    spr.drawCircle(w.x, w.y, w.w, w.color);
+    break;
+  case WIDGET_DIGITS:
+    break;
+  }
+}
+
+// repaint inside the rectangle only, so a partial and a full draw give the same pixels
+static void repaint(TFT_eSprite &spr, const Widget &w, int32_t v) {
+  spr.setViewport(w.x, w.y, w.w, w.h, false);
+  spr.fillRect(w.x, w.y, w.w, w.h, TFT_BLACK);
+  paint(spr, w, v);
+  spr.resetViewport();
+}
+
+static void paintStatic(TFT_eSprite &spr, const Layout *layout, uint8_t n) {
+  spr.fillSprite(TFT_BLACK);
+  for (uint8_t i = 0; i < n; i++) {
+    if (!layout->widgets[i].value)
+      paint(spr, layout->widgets[i], 0);
+  }
+}
+
+// cached static layer of the layout, NULL without PSRAM or once the cache is full
+static TFT_eSprite *staticLayer(TFT_eSprite &sprite, TFT_eSPI &screen, uint8_t n) {
+  for (uint8_t i = 0; i < layerCount; i++) {
+    if (layers[i].layout == current)
+      return layers[i].sprite;
+  }
+  if (!psramFound() || layerCount >= LAYOUT_CACHE_LAYERS)
+    return NULL;
+  TFT_eSprite *layer = new TFT_eSprite(&screen);
+  if (!layer->createSprite(sprite.width(), sprite.height())) {
+    delete layer;
+    return NULL;
+  }
+  layer->setSwapBytes(true);
+  paintStatic(*layer, current, n);
+  layers[layerCount].layout = current;
+  layers[layerCount].sprite = layer;
+  layerCount++;
+  return layer;
+}
+
+bool layoutDraw(TFT_eSprite &sprite, TFT_eSPI &screen) {
+  if (!current)
+    return false;
+  uint8_t n = min((int)current->count, LAYOUT_MAX_WIDGETS);
+
+  if (!valid) {
+    // static widgets from the cache when there is one, a page switch only copies them
+    TFT_eSprite *layer = staticLayer(sprite, screen, n);
+    if (layer)
+      memcpy(sprite.getPointer(), layer->getPointer(), sprite.width() * sprite.height() * 2); // 16 bit colour
+    else
+      paintStatic(sprite, current, n);
+    for (uint8_t i = 0; i < n; i++) {
+      const Widget &w = current->widgets[i];
+      if (w.value) {
+        drawn[i] = w.value();
+        repaint(sprite, w, drawn[i]);
+      }
+    }
+    sprite.pushSprite(0, 0);
+    // the digits area of the sprite is black, the digits go on top
+    for (uint8_t i = 0; i < n; i++) {
+      const Widget &w = current->widgets[i];
+      if (w.kind == WIDGET_DIGITS) {
+        w.digits->invalidate();
+        w.digits->draw(screen, w.x, w.y, drawn[i]);
+      }
+    }
+    valid = true;
+    return true;
+  }
+
+  bool changed = false;
+  for (uint8_t i = 0; i < n; i++) {
+    const Widget &w = current->widgets[i];
+    if (!w.value)
+      continue;
+    int32_t v = w.value();
+    if (v == drawn[i])
+      continue;
+    drawn[i] = v;
+    changed = true;
+    if (w.kind == WIDGET_DIGITS) {
+      w.digits->draw(screen, w.x, w.y, v); // only the changed segments
+      continue;
+    }
+    repaint(sprite, w, v);
+    sprite.pushSprite(w.x, w.y, w.x, w.y, w.w, w.h);
+  }
+  return changed;
+}
@@ -0,0 +1,89 @@
+#ifndef _LAYOUT_H
+#define _LAYOUT_H
+
+#include "TFT_eSPI.h"
+#include "sevenSeg.h"
+#include <Arduino.h>
+
+/*
+Data driven screen layouts. A layout is a table of widgets: a rectangle, a data source, a
+formatter and a style. The source returns the value already quantised to what the widget shows
+(0.01 km for a trip of "12.34", percent for a bar), the renderer keeps the last drawn value of
+every widget and only repaints and pushes the rectangles whose value changed.
+Widgets without a source are static and drawn with the full layout only.
+Rectangles of one layout must not overlap, a repaint clears and clips to its rectangle.
+With PSRAM the static widgets of each layout are rendered once into a layer of their own,
+showing a layout again starts from a copy of that layer.
+*/
+
+#define LAYOUT_MAX_WIDGETS 32
+#define LAYOUT_CACHE_LAYERS 8 // static layers kept in PSRAM, one per layout
+#define WIDGET_HIDDEN INT32_MIN // source value: widget shows nothing
+
+enum WidgetKind {
+  WIDGET_TEXT,   // formatted value or label, anchored in the rectangle by the datum
+  WIDGET_BAR,    // value in percent, colorAlt at or below threshold
+  WIDGET_BOX,    // outline with label or 40x40 icon, color when the value is set, colorAlt otherwise
+  WIDGET_DIGITS, // seven-segment number, drawn straight to the display
+  WIDGET_IMAGE,  // image of the size of the rectangle
+  WIDGET_LINE,   // from x,y to x+w,y+h
+  WIDGET_CIRCLE  // centre x,y, radius w
+};
+
+typedef int32_t (*WidgetValue)();
+typedef String (*WidgetFormat)(int32_t value);
+
+struct Widget {
+  WidgetKind kind;
+  int16_t x, y, w, h;
+  WidgetValue value;   // NULL = static
+  WidgetFormat format; // TEXT, NULL = label shown while the value is not 0
+  const char *label;
+  const uint16_t *image;
+  SevenSeg *digits;
+  uint8_t font;
+  uint8_t datum; // TFT_eSPI datum, TL_DATUM, TR_DATUM and MC_DATUM are supported
+  uint16_t color;
+  uint16_t colorAlt;
+  int16_t threshold;
+};
+
+// table entries of the widget kinds
+#define TEXT_WIDGET(x, y, w, h, value, format, font, datum, color) \
+  { WIDGET_TEXT, x, y, w, h, value, format, NULL, NULL, NULL, font, datum, color, 0, 0 }
+#define LABEL_WIDGET(x, y, w, h, value, label, font, datum, color) \
+  { WIDGET_TEXT, x, y, w, h, value, NULL, label, NULL, NULL, font, datum, color, 0, 0 }
+#define BAR_WIDGET(x, y, w, h, value, color, colorLow, low) \
+  { WIDGET_BAR, x, y, w, h, value, NULL, NULL, NULL, NULL, 0, 0, color, colorLow, low }
+#define BOX_WIDGET(x, y, w, h, value, label, image, colorOn, colorOff) \
+  { WIDGET_BOX, x, y, w, h, value, NULL, label, image, NULL, 2, MC_DATUM, colorOn, colorOff, 0 }
+#define DIGITS_WIDGET(x, y, w, h, value, digits) \
+  { WIDGET_DIGITS, x, y, w, h, value, NULL, NULL, NULL, digits, 0, 0, 0, 0, 0 }
+#define IMAGE_WIDGET(x, y, w, h, image) \
+  { WIDGET_IMAGE, x, y, w, h, NULL, NULL, NULL, image, NULL, 0, 0, 0, 0, 0 }
+#define LINE_WIDGET(x0, y0, x1, y1, color) \
+  { WIDGET_LINE, x0, y0, (x1) - (x0), (y1) - (y0), NULL, NULL, NULL, NULL, NULL, 0, 0, color, 0, 0 }
+#define CIRCLE_WIDGET(x, y, r, color) \
+  { WIDGET_CIRCLE, x, y, r, r, NULL, NULL, NULL, NULL, NULL, 0, 0, color, 0, 0 }
+
+struct Layout {
+  const char *name;
+  const Widget *widgets;
+  uint8_t count;
+};
+
+#define LAYOUT(name, table) \
+  { name, table, sizeof(table) / sizeof(table[0]) }
+
+// Show a layout, the next layoutDraw() draws it completely
+void layoutSelect(const Layout *layout);
+
+const Layout *layoutCurrent();
+
+// The screen was overwritten, the next layoutDraw() draws everything
+void layoutInvalidate();
+
+// Repaint the widgets whose value changed, false if nothing was drawn
+bool layoutDraw(TFT_eSprite &sprite, TFT_eSPI &screen);
+
+#endif
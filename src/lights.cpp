@@ -0,0 +1,197 @@
+#include "lights.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+static LightsCfg lcfg;
+static ledc_channel_t ledcChannel;
+static TaskHandle_t lightTask = NULL;
+static esp_timer_handle_t lightTimer = NULL;
+static volatile bool brakeSw = false;
+static volatile bool brakeTh = false;
+static volatile uint8_t flashToggles = 0; // remaining on/off changes of the brake flash
+static volatile uint16_t fadeSteps = 0;   // remaining 10ms steps of the release fade
+static uint32_t fadeFrom = 0;             // duty the fade started at
+static volatile bool dimChanged = false;
+static volatile bool timerTick = false;
+static bool brakeShown = false;
+static bool headlightOn = false;
+
+static void setDuty(uint32_t duty) {
+  ledc_set_duty_and_update(LEDC_LOW_SPEED_MODE, ledcChannel, duty, 0);
+}
+
+static void IRAM_ATTR brakeSwIsr() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(lightTask, &woken);
+  if (woken)
+    portYIELD_FROM_ISR();
+}
+
+// the timer runs in the esp_timer task, every duty is written by the light task
+static void lightTimerCb(void *arg) {
+  timerTick = true;
+  xTaskNotifyGive(lightTask);
+}
+
+// brake flash: toggle between brake and dim duty, ends on brake duty
+// fade: step from the duty it started at to dim duty
+static void stepLight() {
+  if (flashToggles > 0) {
+    flashToggles--;
+    setDuty((flashToggles & 1) ? lcfg.dimDuty : lcfg.brakeDuty);
+    if (flashToggles == 0)
+      esp_timer_stop(lightTimer);
+  }
+  else if (fadeSteps > 0) {
+    fadeSteps--;
+    uint16_t total = lcfg.fadeMs / 10;
+    setDuty(lcfg.dimDuty + ((int32_t)fadeFrom - lcfg.dimDuty) * fadeSteps / total);
+    if (fadeSteps == 0)
+      esp_timer_stop(lightTimer);
+  }
+  else {
+    esp_timer_stop(lightTimer);
+  }
+}
+
+static void stopTimer() {
+  if (lightTimer != NULL) {
+    esp_timer_stop(lightTimer);
+    timerTick = false;
+    flashToggles = 0;
+    fadeSteps = 0;
+  }
+}
+
+// soft transition from a duty to dim duty
+static void fadeToDim(uint32_t from) {
+  if (lcfg.fadeMs >= 20 && lightTimer != NULL) {
+    fadeFrom = from;
+    fadeSteps = lcfg.fadeMs / 10;
+    esp_timer_start_periodic(lightTimer, 10000);
+  }
+  else {
+    setDuty(lcfg.dimDuty);
+  }
+}
+
+static void applyBrake(bool brake) {
+  stopTimer();
+  if (brake) {
+    // never fade in, the brake light has to be instant
+    setDuty(lcfg.brakeDuty);
+    if (lcfg.flashCount > 0 && lightTimer != NULL) {
+      flashToggles = lcfg.flashCount * 2;
+      esp_timer_start_periodic(lightTimer, lcfg.flashPeriodMs * 500UL);
+    }
+  }
+  else {
+    fadeToDim(lcfg.brakeDuty);
+  }
+}
+
+static void lightTaskFunc(void *arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (timerTick) {
+      timerTick = false;
+      stepLight();
+    }
+    bool sw = digitalRead(lcfg.brakeSwPin) == HIGH;
+    bool swChanged = sw != brakeSw;
+    brakeSw = sw;
+    bool brake = brakeSw || brakeTh;
+    if (brake != brakeShown) {
+      brakeShown = brake;
+      applyBrake(brake);
+    }
+    else if (dimChanged && !brake) {
+      // from where the light is now, a running release fade continues towards the new dim duty
+      uint32_t duty = ledc_get_duty(LEDC_LOW_SPEED_MODE, ledcChannel);
+      stopTimer();
+      fadeToDim(duty);
+    }
+    dimChanged = false;
+    if (swChanged) {
+      // the first edge switches at once, the bouncing after it is ignored, then the settled level is read
+      vTaskDelay(pdMS_TO_TICKS(LIGHTS_DEBOUNCE_MS));
+      xTaskNotifyGive(lightTask);
+    }
+  }
+}
+
+void lightsBegin(const LightsCfg &cfg) {
+  lcfg = cfg;
+  ledcChannel = (ledc_channel_t)(cfg.pwmChannel % 8);
+
+  pinMode(cfg.headlightPin, OUTPUT);
+  digitalWrite(cfg.headlightPin, LOW);
+  pinMode(cfg.brakeSwPin, INPUT);
+
+  // clocked from the internal RC oscillator (RTC8M) instead of the APB, it keeps running in light sleep
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = LEDC_LOW_SPEED_MODE;
+  timer.duty_resolution = LEDC_TIMER_8_BIT;
+  timer.timer_num = (ledc_timer_t)(cfg.pwmChannel / 2 % 4); // same timer as ledcSetup() of the channel
+  timer.freq_hz = 500;
+  timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+  ledc_timer_config(&timer);
+  ledc_channel_config_t channel = {};
+  channel.gpio_num = cfg.rearPin;
+  channel.speed_mode = LEDC_LOW_SPEED_MODE;
+  channel.channel = ledcChannel;
+  channel.timer_sel = timer.timer_num;
+  channel.duty = cfg.dimDuty;
+  ledc_channel_config(&channel);
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+  // both outputs keep their function through light sleep
+  gpio_sleep_sel_dis((gpio_num_t)cfg.rearPin);
+  gpio_sleep_sel_dis((gpio_num_t)cfg.headlightPin);
+
+  if (cfg.flashCount > 0 || cfg.fadeMs > 0) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = lightTimerCb;
+    timerArgs.name = "lights";
+    esp_timer_create(&timerArgs, &lightTimer);
+  }
+
+  xTaskCreatePinnedToCore(lightTaskFunc, "lights", 2048, NULL, configMAX_PRIORITIES - 1, &lightTask, 1);
+  attachInterrupt(cfg.brakeSwPin, brakeSwIsr, CHANGE);
+  xTaskNotifyGive(lightTask);
+}
+
+void lightsSetThrottleBrake(bool on) {
+  if (on == brakeTh)
+    return;
+  brakeTh = on;
+  xTaskNotifyGive(lightTask);
+}
+
+void lightsSetDim(uint8_t duty) {
+  if (duty == lcfg.dimDuty)
+    return;
+  lcfg.dimDuty = duty;
+  dimChanged = true;
+  xTaskNotifyGive(lightTask);
+}
+
+void lightsSetHeadlight(bool on) {
+  if (on == headlightOn)
+    return;
+  headlightOn = on;
+  digitalWrite(lcfg.headlightPin, on ? HIGH : LOW);
+}
+
+bool lightsBrakeSwitch() {
+  return brakeSw;
+}
+
+bool lightsBusy() {
+  return flashToggles > 0 || fadeSteps > 0;
+}
+
+void lightsWakeup() {
+  xTaskNotifyGive(lightTask);
+}
@@ -0,0 +1,51 @@
+#ifndef _LIGHTS_H
+#define _LIGHTS_H
+
+#include <Arduino.h>
+
+#ifndef LIGHTS_DEBOUNCE_MS
+  #define LIGHTS_DEBOUNCE_MS 5 // brake switch edges ignored after a change
+#endif
+
+/*
+Rear/brake light and headlight output. The brake switch is read by a GPIO interrupt, the
+throttle brake comes from the control job; both drive the LEDC channel from a dedicated task,
+independent of the main loop. The LEDC runs on the RTC8M clock, so the rear light stays lit in
+light sleep. The brake switch is debounced in the task, the first edge
+switches the light at once. Optional timer stepped release fade and brake flash, the timer
+only wakes the task. Not an LEDC hardware fade: with IDF 4.4 ledc_set_duty_and_update() waits
+for a running fade to end and there is no ledc_fade_stop(), a brake would be late by the fade.
+*/
+
+struct LightsCfg {
+  uint8_t rearPin;
+  uint8_t brakeSwPin;
+  uint8_t headlightPin;
+  uint8_t pwmChannel;
+  uint8_t dimDuty;       // rear light when not braking
+  uint8_t brakeDuty;     // rear light when braking
+  uint16_t fadeMs;       // soft transition when the brake is released, 0 = off
+  uint8_t flashCount;    // flashes when the brake light turns on, 0 = off
+  uint16_t flashPeriodMs;
+};
+
+void lightsBegin(const LightsCfg &cfg);
+
+// Brake request from the throttle, evaluated in the control job
+void lightsSetThrottleBrake(bool on);
+
+void lightsSetHeadlight(bool on);
+
+// Change the rear light duty when not braking
+void lightsSetDim(uint8_t duty);
+
+// Debounced state of the brake switch
+bool lightsBrakeSwitch();
+
+// A fade or flash is stepped by the timer, no light sleep until it ended
+bool lightsBusy();
+
+// A light sleep ended, the edge of the brake switch may have been lost there; reads it again
+void lightsWakeup();
+
+#endif
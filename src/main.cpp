@@ -9,12 +9,28 @@ Description: Control VESC based ESC, set Profiles, Display Data, Lockscreen, Ove
 #include "LiPoCheck.h"
 #include "TFT_eSPI.h"
 #include "VescComms.h"
+#include "batteryEstimator.h"
+#include "boostedBms.h"
+#include "configStore.h"
+#include "rangeEstimator.h"
 #include "Wire.h"
 #include "config.h"
 #include "display.h"
-#include "driver/ledc.h" //for PWM
+#include "latency.h"
+#include "odometer.h"
+#include "params.h"
+#include "power.h"
+#include "rideStats.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "lights.h"
+#include "throttleAdc.h"
+#include "touch.h"
+#include "ui.h"
+#include "units.h"
+#include "vescSetup.h"
+#include "webConfig.h"
 #include <ArduinoOTA.h>
-#include <CST816S.h> //TouchLib
 #include <ESPmDNS.h>
 #include <WiFi.h>
 #include <WiFiUdp.h>
@@ -22,11 +38,11 @@ const char *ssid = WIFI_SSID;
 const char *password = WIFI_PASS;
 bool WIFI = 0;
 
-#include <SimpleKalmanFilter.h> //to smooth throttle value
-SimpleKalmanFilter thFilter(2, 2, 0.01);
+#include "throttleCurve.h"
+ThrottleCurve thCurveMap;
 
-#include <Preferences.h>
-Preferences pref;
+#include "throttleFilter.h" //to smooth throttle value
+ThrottleFilter thFilter((ThrottleFilterType)thFilterType, thFilterMs);
 
 #if VESC_COMM_TYPE == 2
 // Using CAN
@@ -36,16 +52,7 @@ HardwareSerial SerialVESC(2);
 #endif
 VescComms Vesc;
 
-#if USE_IMPERIAL_UNITS == 1
-  #define CONVERT_UNIT(v) ((v) * 0.621371)
-  #define UNIT_DIST_STR "mi"
-#else
-  #define CONVERT_UNIT(v) (v)
-  #define UNIT_DIST_STR "km"
-#endif
-
-// images & font
-#include "DSEG7.h"
+// images
 #include "Esc.h"
 #include "Light.h"
 #include "Mot.h"
@@ -69,22 +76,48 @@ VescComms Vesc;
 #define PIN_RX 43 // Lilygo Pin43=RX to VescTX
 #define DEVICE_NAME "revolution-dashboard"
 
+// scheduler periods
+#define CONTROL_PERIOD_US 10000    // 100 Hz
+#define TELEMETRY_PERIOD_US (telemFastMs * 1000UL) // fast telemetry class
+#define RENDER_PERIOD_US 33333     // 30 Hz
+#define RENDER_IDLE_PERIOD_US 250000 // 4 Hz while nothing changes
+#define CONTROL_LOCKED_PERIOD_US 50000 // locked: only the brake light follows the throttle
+#define SERVICE_PERIOD_US 200000   // 5 Hz
+#define BMS_PERIOD_US 500000       // DieBieMS values and cells, every second each
+// voltage with the current in the fast class, the battery estimator needs them as pairs
+#define TELEM_FAST_FIELDS (TELEM_RPM | TELEM_MOTOR_CURRENT | TELEM_INPUT_CURRENT | TELEM_TACHO | TELEM_VOLTAGE)
+
+static int controlJobId = -1;
+static int telemetryJobId = -1;
+static int renderJobId = -1;
+
 void lockscreen(int x, int y);
-void drawScreen();
+void controlJob(uint32_t nowUs);
+void telemetryJob(uint32_t nowUs);
+void uiJob(uint32_t nowUs);
+void serviceJob(uint32_t nowUs);
+void bmsJob(uint32_t nowUs);
+void serialCommand(const String &line);
+void applyPowerMode(PowerMode mode);
+void buildThrottleCurve();
 
 // setup PWM for rearlight
 const int PWM_CHANNEL = 1;
-const int PWM_FREQ = 500;
-const int PWM_RESOLUTION = 8;
-const int backLight_DUTY_CYCLE = dimmBL;
 const int brakeLight_DUTY_CYCLE = 255; // 255 for max brightness = brakelight
+const int brakeFlash_PERIOD = 120;     // ms of one on/off cycle of the brake flash
 
-float erpm = 0;
+int32_t erpm = 0;
 float rpm = 0;
-float speed = 0;
-int batt = 0;
+float speed = 0; // display units per hour
+float batt = 0;
 int battPerc;
-float trip;
+BatteryEstimator battEst(numbCell, battCap);
+Conversion<DisplayUnits> displayConv; // speed, rpm and trip, scaled by the VESC setup or the runtime parameters
+Conversion<MetricUnits> metricConv;   // ride statistics and range
+RangeEstimator rangeEst;
+float whKm = 0;   // energy use of the last 5 km
+float range = -1; // km, -1 = unknown
+float trip; // display units
 int escT = 0;
 int motT = 0;
 bool profSet = 0;
@@ -97,8 +130,6 @@ bool confMode = 0;
 String entry = "";
 
 int nunck = 127;
-uint32_t filterTime = 0; // for Kalman Filter
-bool filterDelay = 1;
 
 unsigned int maxVal = 0;
 unsigned int minVal = 0;
@@ -107,12 +138,6 @@ unsigned int thZero;
 unsigned int thMin;
 unsigned int throttleRAW;
 
-// debounce for touch
-unsigned long lastTouchTime = 0;   // to manage debounce
-unsigned long debounceDelay = 300; // delay in milliseconds to wait for next valid touch input
-
-CST816S touch(18, 17, 21, 16); // sda, scl, rst, irq
-
 void configureWifi() {
   if (!WIFI && WiFi.status() == WL_CONNECTED) {
     WIFI = true;
@@ -123,23 +148,82 @@ void configureWifi() {
 
     // Setup OTA
     ArduinoOTA.setHostname(DEVICE_NAME);
+    ArduinoOTA.onStart([]() { // the update ends in a restart
+      odometerFlush();
+      rideStatsSave();
+    });
     ArduinoOTA.begin();
+
+    webConfigBegin();
+  }
+}
+
+// runtime parameters, the defaults come from config.h; new unlock codes are used after a restart
+static const ParamDef paramTable[] = {
+    PARAM("vescSetup", PARAM_BOOL, vescSetup, 0, 1, 1, vescSetup, 0),
+    PARAM("wheelDia", PARAM_INT, wheelDia, 50, 1000, 1, wheelDia, 0),
+    PARAM("motPol", PARAM_INT, motPol, 1, 100, 1, motPol, 0),
+    PARAM("tachComp", PARAM_FLOAT, tachComp, 0.5, 2, 0.01, tachComp, 0),
+    PARAM("numbCell", PARAM_INT, numbCell, 1, 30, 1, numbCell, 0),
+    PARAM("battChem", PARAM_INT, battChem, 0, 2, 1, battChem, 0),
+    PARAM("battCap", PARAM_FLOAT, battCap, 0, 100, 0.1, battCap, 0),
+    PARAM("thPercentage", PARAM_FLOAT, thPercentage, 10, 100, 1, thPercentage, 0),
+    PARAM("thComp", PARAM_INT, thComp, 0, 1000, 10, thComp, 0),
+    PARAM("voltdropcomp", PARAM_BOOL, voltdropcomp, 0, 1, 1, voltdropcomp, 0),
+    PARAM("stopOnBrake", PARAM_BOOL, stopOnBrake, 0, 1, 1, stopOnBrake, 0),
+    PARAM("showThReading", PARAM_BOOL, showThReading, 0, 1, 1, showThReading, 0),
+    PARAM("dashLayout", PARAM_INT, dashLayout, 0, 1, 1, dashLayout, 0),
+    PARAM("dimmBL", PARAM_INT, dimmBL, 0, 255, 5, dimmBL, 0),
+    PARAM("mode1", PARAM_INT, mode1, 0, 9999, 1, mode1, PARAM_SECRET),
+    PARAM("mode2", PARAM_INT, mode2, 0, 9999, 1, mode2, PARAM_SECRET),
+    PARAM("throttleCal", PARAM_INT, throttleCal, 0, 9999, 1, throttleCal, PARAM_SECRET),
+};
+
+// recompute everything that depends on the runtime parameters, once per change
+void applySettings() {
+  const ConfigData &c = config();
+  float speedFactor; // km/h per eRPM
+  float tripFactor;  // km per tachometer step
+  if (c.vescSetup && vescSetupValid()) {
+    speedFactor = vescSetupSpeedFactor();
+    tripFactor = vescSetupTripFactor() * c.tachComp;
+  }
+  else {
+    speedFactor = c.wheelDia * 3.1415 * 0.00006 / c.motPol;
+    tripFactor = c.tachComp / c.wheelDia / 1000;
   }
+  displayConv.setScale(speedFactor, tripFactor, c.motPol);
+  metricConv.setScale(speedFactor, tripFactor, c.motPol);
+  odometerSetScale(tripFactor * 1000); // same distance scaling as the trip
+  battEst.setPack(c.numbCell, c.battCap);
+  SocInit(c.battChem);
+  lightsSetDim(c.dimmBL);
+  setDashboardLayout(c.dashLayout);
+  buildThrottleCurve();
 }
 
-bool wasTouched = false;
+// build the throttle lookup table of the current mode
+void buildThrottleCurve() {
+  int m = modeS ? 1 : 0;
+  ThrottleCurveCfg cfg;
+  cfg.shape = thCurve[m];
+  cfg.expo = thExpo[m];
+  cfg.maxOut = modeS ? 128 : config().thPercentage * 0.01f * 127; // 255 in mode 2, the mode 1 cap as before
+  cfg.brakeShape = brakeCurve;
+  cfg.brakeExpo = brakeExpo;
+  cfg.deadband = thDeadband;
+  cfg.accelRate = thAccelRate[m];
+  thCurveMap.build(cfg, thMin, thZero, thMax);
+}
 
 void setup() {
-  pref.begin("thValues", false); //"false" defines read/write access
-  thMax = pref.getUInt("thMax", 0);
-  thZero = pref.getUInt("thZero", 0);
-  thMin = pref.getUInt("thMin", 0);
-  pref.end();
-
-  // Load Lock Mode
-  pref.begin("lockCfg", false);
-  lockMode = (LockMode)pref.getUInt("lockMode", (int)PATTERN);
-  pref.end();
+  Serial.begin(115200);
+  configBegin();
+  thMax = config().thMax;
+  thZero = config().thZero;
+  thMin = config().thMin;
+  lockMode = (LockMode)config().lockMode;
+  paramsBegin(paramTable, sizeof(paramTable) / sizeof(paramTable[0]), applySettings);
 
   // OTA
   WiFi.mode(WIFI_STA);
@@ -157,167 +241,100 @@ void setup() {
   Vesc.setSerialPort(&SerialVESC);
 #endif
   Vesc.getFWversion();
+  vescSetupBegin(&Vesc, applySettings); // speed and distance scaling of the VESC, cached per firmware
+#if BOOSTED_BMS
+  boostedBmsBegin(&Vesc); // keep-alive by timer, BMS frames are decoded while receiving
+#endif
+  odometerBegin(config().tachComp / config().wheelDia); // same distance scaling as the trip
+  rideStatsBegin();
+  telemetryBegin(&Vesc);
+  telemetrySetClass(TELEM_FAST, TELEM_FAST_FIELDS, telemFastMs);
+  telemetrySetClass(TELEM_SLOW,
+                    TELEM_TEMP_FET | TELEM_TEMP_MOTOR | TELEM_AH | TELEM_AH_CHARGED | TELEM_WH | TELEM_WH_CHARGED |
+                        TELEM_TACHO_ABS | TELEM_FAULT,
+                    telemSlowMs);
   // setup the input & output pins
-  pinMode(headlight, OUTPUT);
-  pinMode(brakeSw, INPUT);
+  LightsCfg lightsCfg;
+  lightsCfg.rearPin = rearlight;
+  lightsCfg.brakeSwPin = brakeSw;
+  lightsCfg.headlightPin = headlight;
+  lightsCfg.pwmChannel = PWM_CHANNEL;
+  lightsCfg.dimDuty = config().dimmBL;
+  lightsCfg.brakeDuty = brakeLight_DUTY_CYCLE;
+  lightsCfg.fadeMs = brakeFade;
+  lightsCfg.flashCount = brakeFlash;
+  lightsCfg.flashPeriodMs = brakeFlash_PERIOD;
+  lightsBegin(lightsCfg);
   pinMode(throttle, INPUT);
-  maxVal = analogRead(throttle);
-  minVal = analogRead(throttle);
-  ledcSetup(PWM_CHANNEL, PWM_FREQ, PWM_RESOLUTION);
-  ledcAttachPin(rearlight, PWM_CHANNEL);
+  throttleAdcBegin(throttle);
+  maxVal = throttleAdcRead();
+  minVal = throttleAdcRead();
+  thFilter.setNoise(thFilterNoise);
+  thFilter.setSpeedResponse(thFilterSpeed, thFilterMs);
+  applySettings();
   // display
   initDisplay();
   // touch
   pinMode(PIN_POWER_ON, OUTPUT);
   digitalWrite(PIN_POWER_ON, HIGH);
-  touch.begin();
+  initTouch();
+  powerBegin(TOUCH_IRQ, brakeSw);
 
   delay(2500); // waiting to start the VESC
-  lockscreen(-1, -1, mode1, mode2, throttleCal);
+  uiBegin(config().mode1, config().mode2, config().throttleCal);
+
+  controlJobId = schedulerAdd("control", controlJob, CONTROL_PERIOD_US, 3, 1000);
+  telemetryJobId = schedulerAdd("telemetry", telemetryJob, TELEMETRY_PERIOD_US, 2, 5000);
+  renderJobId = schedulerAdd("render", uiJob, RENDER_PERIOD_US, 1, 20000);
+  schedulerAdd("service", serviceJob, SERVICE_PERIOD_US, 0, 5000);
+  if (dieBieMS != 0)
+    schedulerAdd("bms", bmsJob, BMS_PERIOD_US, 0, 1000);
 }
 
-void loop() {
-  // OTA
-  configureWifi();
-  ArduinoOTA.handle();
+// throttle, lights and nunchuck command
+void controlJob(uint32_t nowUs) {
+  // filter the throttle value, once per decimated ADC value
+  uint16_t thSample;
+  uint32_t thSampleTime;
+  if (throttleAdcAvailable(&thSample, &thSampleTime)) {
+    LATENCY_MARK(LAT_ADC, thSampleTime);
+    thFilter.update(thSample, thSampleTime);
+    LATENCY_MARK(LAT_FILTER, micros());
+  }
+  throttleRAW = thFilter.value();
 
-  // Lockscreen
-  LockMode lastLockMode = lockMode;
-  static unsigned long lastSeenTouch = 0;
-
-  while (lock == 1 && confMode == 0) {
-    bool isTouched = touch.available();
-
-    if (isTouched) {
-      lastSeenTouch = millis();
-      unsigned long currentTouchTime = millis();
-
-      if (lockMode == PATTERN) {
-        // Pattern Mode: Continuous Drag
-        if (currentTouchTime - lastTouchTime > 500) {
-          entry = "";
-        }
-        lastTouchTime = currentTouchTime;
-        lockscreen(touch.data.x, touch.data.y, mode1, mode2, throttleCal);
-        delay(20);
-        wasTouched = true;
-      }
-      else {
-        // PIN Mode
-        if (touch.data.y < 80) {
-          // Header Area: Allow continuous calls for Long Press Toggle
-          lockscreen(touch.data.x, touch.data.y, mode1, mode2, throttleCal);
-          wasTouched = true;
-        }
-        else {
-          // Keypad Area: Single Press (with Hysteresis)
-          if (!wasTouched) {
-            wasTouched = true;
-            lockscreen(touch.data.x, touch.data.y, mode1, mode2, throttleCal);
-            lastTouchTime = millis();
-          }
-        }
-      }
+  // switch headlight
+  lightsSetHeadlight(lightF == HIGH);
 
-      // Save Lock Mode if changed
-      if (lockMode != lastLockMode) {
-        pref.begin("lockCfg", false);
-        pref.putUInt("lockMode", (int)lockMode);
-        pref.end();
-        lastLockMode = lockMode;
-      }
-    }
-    else {
-      // Only reset wasTouched if release is stable (>50ms)
-      if (millis() - lastSeenTouch > 50) {
-        if (wasTouched) {
-          wasTouched = false;
-          // Force redraw to clear highlights in PIN mode
-          if (lockMode == PIN) {
-            lockscreen(-1, -1, mode1, mode2, throttleCal);
-          }
-        }
-      }
+  // handling brakelight, the brake switch is handled by its interrupt
+  lightsSetThrottleBrake(throttleRAW < thZero - 250); // reduce -250 for brakelight deadband
 
-      // Pattern Mode: Reset on Release if incorrect
-      if (lockMode == PATTERN && entry.length() > 0) {
-        if (millis() - lastTouchTime > 150) { // 150ms stable release
-          entry = "";
-          lockscreen(-1, -1, mode1, mode2, throttleCal); // Clear visuals
-        }
-      }
-    }
+  if (lightF == HIGH && config().voltdropcomp == 1) { // compensation of the voltage drop when headlight is turned on
+    throttleRAW = throttleRAW + config().thComp;
   }
 
-  // calculate the estimated value with Kalman Filter
-  throttleRAW = thFilter.updateEstimate(analogRead(throttle));
-
-  // calibrate throttle
-  while (confMode == 1) {
-    mainSprite.fillSprite(TFT_BLACK);
-    mainSprite.setTextColor(TFT_WHITE, TFT_BLACK);
-    mainSprite.setTextDatum(4);
-    mainSprite.drawString("move throttle", 85, 20, 2);
-    mainSprite.drawString("a few times from", 85, 40, 2);
-    mainSprite.drawString("full throttle to full brake", 85, 60, 2);
-    mainSprite.drawString("and press OK", 85, 80, 2);
-    mainSprite.drawRoundRect(10, 245, 70, 50, 2, TFT_RED);
-    mainSprite.drawString("X", 45, 272, 4);
-    mainSprite.drawRoundRect(90, 245, 70, 50, 2, TFT_GREEN);
-    mainSprite.drawString("OK", 125, 272, 4);
-
-    unsigned int throttleRAW = thFilter.updateEstimate(analogRead(throttle));
-
-    if (throttleRAW > maxVal) {
-      maxVal = throttleRAW;
-    }
+  // calc nunchuck value
+  nunck = thCurveMap.map(throttleRAW);
 
-    if (throttleRAW < minVal) {
-      minVal = throttleRAW;
-    }
+  if (lightsBrakeSwitch() && nunck > 127 && config().stopOnBrake == 1) {
+    nunck = 127; // interrupts acceleration when braking
+  }
 
-    mainSprite.setTextDatum(0);
-    mainSprite.drawString("old Value", 5, 110, 2);
-    mainSprite.drawString(String(thMax), 5, 130, 4);
-    mainSprite.drawString(String(thZero), 5, 160, 4);
-    mainSprite.drawString(String(thMin), 5, 190, 4);
-
-    mainSprite.setTextDatum(2);
-    mainSprite.drawString("new Value", 165, 110, 2);
-    mainSprite.drawString(String(maxVal), 165, 130, 4);
-    mainSprite.drawString(String(throttleRAW), 165, 160, 4);
-    mainSprite.drawString(String(minVal), 165, 190, 4);
-
-    mainSprite.pushSprite(0, 0);
-
-    if (touch.available()) {
-      if (!wasTouched) {
-        wasTouched = true;
-        if (touch.data.y > 245 && touch.data.y < 295 && touch.data.x > 85) {
-          pref.begin("thValues", false);
-          pref.putUInt("thMax", maxVal);       // at 5V input, the Hall Sensor Value should be 4095 on full throttle
-          pref.putUInt("thZero", throttleRAW); // schould be about 2880, depends on input Voltage ~ 5V
-          pref.putUInt("thMin", minVal);       // schould be about 2100, depends on input Voltage ~ 5V
-          pref.end();
-          mainSprite.fillSprite(TFT_BLACK);
-          mainSprite.pushSprite(0, 0);
-          delay(100);
-          ESP.restart();
-        }
-        if (touch.data.y > 245 && touch.data.y < 295 && touch.data.x < 85) {
-          mainSprite.fillSprite(TFT_BLACK);
-          mainSprite.pushSprite(0, 0);
-          ESP.restart();
-        }
-      }
-    }
-    else {
-      wasTouched = false;
-    }
+  if (uiState != UI_DASHBOARD) {
+    return; // locked or calibrating: never drive
   }
+  nunck = thCurveMap.limit(nunck, nowUs);
+  LATENCY_MARK(LAT_COMMAND, micros());
 
+  // send nunchuck value to VESC
+  Vesc.nunchuck.valueY = nunck;
+  Vesc.setNunchuckValues();
+}
+
+// VESC data and profile
+void telemetryJob(uint32_t nowUs) {
   // set profile
-  if (modeS == 1 && profSet == 0) {
+  if (uiState == UI_DASHBOARD && modeS == 1 && profSet == 0) {
     bool store = false;      // save persistently the new profile in vesc memory
     bool forward_can = true; // forward profile to slave Vesc through can bus
     bool ack = false;
@@ -340,90 +357,188 @@ void loop() {
     profSet = 1;
   }
 
-  // switch headlight
-  // switch headlight
-  bool isTouched = touch.available();
-  if (isTouched) {
-    if (!wasTouched) {
-      wasTouched = true;
-      if (touch.data.y >= 212)
-        lightF = !lightF;
-    }
-  }
-  else {
-    wasTouched = false;
-  }
-
-  if (lightF == HIGH) {
-    digitalWrite(headlight, HIGH);
-  }
-  else {
-    digitalWrite(headlight, LOW);
-  }
-
-  // handling brakelight
-  if (digitalRead(brakeSw) == HIGH || throttleRAW < thZero - 250) { // reduce -250 for brakelight deadband
-    ledcWrite(PWM_CHANNEL, brakeLight_DUTY_CYCLE);
-  }
-  else {
-    ledcWrite(PWM_CHANNEL, backLight_DUTY_CYCLE);
-  }
-
-  // reading VESC data
-  if (Vesc.getVescValues()) {
+  // reading VESC data, the fields come in at the rate of their telemetry class
+  uint32_t fields = telemetryPoll(nowUs / 1000);
+  if (fields & TELEM_RPM)
     erpm = Vesc.data.rpm;
+  if (fields & TELEM_VOLTAGE) {
     batt = Vesc.data.inpVoltage;
+    battEst.update(batt, Vesc.data.avgInputCurrent, nowUs / 1000);
+  }
+  if (fields & TELEM_AH)
+    battEst.updateCharge(Vesc.data.ampHours, Vesc.data.ampHoursCharged);
+  if (fields & TELEM_TACHO_ABS)
+    odometerUpdate(Vesc.data.tachometerAbs, nowUs / 1000);
+  if (fields & TELEM_WH) {
+    // same distance scaling as the trip
+    rangeEst.update(Vesc.data.watt_hours, Vesc.data.watt_hours_charged, metricConv.distance(Vesc.data.tachometerAbs) * 1000);
+    whKm = rangeEst.whPerKm(RANGE_5KM);
+    range = rangeEst.rangeKm(config().battCap * battEst.ocv() * battEst.soc() / 100);
+  }
+  if (fields & TELEM_TEMP_FET)
     escT = Vesc.data.tempFET;
+  if (fields & TELEM_TEMP_MOTOR)
     motT = Vesc.data.tempMotor;
-    trip = Vesc.data.tachometer;
+  rpm = displayConv.rpm(erpm);
+  speed = displayConv.speed(erpm);
+  trip = displayConv.distance(Vesc.data.tachometer);
+  battPerc = battEst.soc() + 0.5;
+
+  if (fields != 0) {
+    RideSample sample;
+    sample.speed = fabsf(metricConv.speed(erpm));
+    sample.motorCurrent = Vesc.data.avgMotorCurrent;
+    sample.inputCurrent = Vesc.data.avgInputCurrent;
+    sample.voltage = Vesc.data.inpVoltage;
+    sample.tempFet = Vesc.data.tempFET;
+    sample.tempMotor = Vesc.data.tempMotor;
+    sample.wattHours = Vesc.data.watt_hours;
+    sample.wattHoursCharged = Vesc.data.watt_hours_charged;
+    rideStatsUpdate(sample, nowUs / 1000);
   }
-  rpm = erpm / motPol;
-  speed = erpm / motPol * wheelDia * 3.1415 * 0.00006;
-  trip = trip / wheelDia / 1000 * tachComp;
-  battPerc = CapCheckPerc(batt, numbCell);
+}
 
-  // calc nunchuck value
-  float maxNunck;
-  if (modeS == true) {
-    maxNunck = 255;
-  }
-  else {
-    maxNunck = thPercentage * 0.01 * 127 + 127;
+// Lockscreen, calibration and dashboard
+void uiJob(uint32_t nowUs) {
+  UiState lastUiState = uiState;
+  uint32_t now = millis();
+  uiTick(now);
+  if (uiState == UI_DASHBOARD && lastUiState != UI_DASHBOARD) {
+    buildThrottleCurve(); // unlocked, the mode is known now
+    thCurveMap.reset();
   }
 
-  if (lightF == HIGH && voltdropcomp == 1) { // compensation of the voltage drop when headlight is turned on
-    throttleRAW = throttleRAW + thComp;
+  // fields of the visible page on top of the fast and slow classes, which feed control and statistics
+  static uint32_t pageFields = 0;
+  uint32_t fields = uiTelemetry();
+  if (fields != pageFields) {
+    pageFields = fields;
+    telemetrySetClass(TELEM_PAGE, fields, telemPageMs);
   }
 
-  if (throttleRAW > thZero) {
-    nunck = map(throttleRAW, thZero, thMax + 100, 127, maxNunck); //+100 to avoid running out of range
+  // frame rate and clock follow the content: full rate while it changes, low rate when idle
+  bool active = uiActive(now);
+  schedulerSetPeriod(renderJobId, active ? RENDER_PERIOD_US : RENDER_IDLE_PERIOD_US);
+  if (uiState == UI_LOCKED)
+    applyPowerMode(POWER_LOCKED);
+  else
+    applyPowerMode(active ? POWER_RIDE : POWER_IDLE);
+}
 
-#if BOOSTED_BMS
-                                                                  // BMS Keep Alive
-    static unsigned long lastKeepAliveTime = 0;
-    if (millis() - lastKeepAliveTime > 10000) {
-      Vesc.sendKeepAlive();
-      lastKeepAliveTime = millis();
-    }
-#endif
+// clock and poll rates of a power mode, while locked no throttle command is sent and the VESC is polled slower
+void applyPowerMode(PowerMode mode) {
+  if (mode == powerMode())
+    return;
+  bool locked = mode == POWER_LOCKED;
+  powerSetMode(mode);
+  schedulerSetPeriod(controlJobId, locked ? CONTROL_LOCKED_PERIOD_US : CONTROL_PERIOD_US);
+  schedulerSetPeriod(telemetryJobId, locked ? telemSlowMs * 1000UL : TELEMETRY_PERIOD_US);
+  telemetrySetClass(TELEM_FAST, TELEM_FAST_FIELDS, locked ? telemSlowMs : telemFastMs);
+}
+
+// DieBieMS polling, over CAN the requests only go out, the replies are decoded when they come in
+void bmsJob(uint32_t nowUs) {
+  static bool cells = false;
+  if (cells)
+    Vesc.getDieBieMSCellsVoltage(dieBieMS);
+  else
+    Vesc.getDieBieMSValues(dieBieMS);
+  cells = !cells;
+}
+
+// serial console, parameters can only be changed while unlocked
+void serialCommand(const String &line) {
+  if (paramsCommand(line, Serial, uiEditAllowed()))
+    return;
+  if (line.length() != 1)
+    return;
+  char c = line[0];
+  if (c == 's')
+    schedulerReport(Serial);
+  if (c == 't')
+    telemetryReport(Serial);
+  if (c == 'o')
+    Serial.printf("odometer %.3f km, session %.3f km\n", odometerMeters() / 1000, odometerSessionMeters() / 1000);
+  if (c == 'b')
+    Serial.printf("batt %.2f V, ocv %.2f V, %.1f %%, R %.0f mOhm\n", batt, battEst.ocv(), battEst.soc(),
+                  battEst.resistance() * 1000);
+  if (c == 'b' && Vesc.DieBieMSlastMs != 0) {
+    Serial.printf("diebiems %.2f V, %.2f A, %u %%, %u cells %.3f-%.3f V (avg %.3f), %.1f C, fault %u\n",
+                  Vesc.DieBieMSdata.packVoltage, Vesc.DieBieMSdata.packCurrent, Vesc.DieBieMSdata.soc,
+                  Vesc.DieBieMScells.cellsReceived, Vesc.DieBieMScells.cellMin, Vesc.DieBieMScells.cellMax,
+                  Vesc.DieBieMScells.cellAverage, Vesc.DieBieMSdata.tempBatteryHigh, Vesc.DieBieMSdata.faultState);
   }
-  else if (throttleRAW < thZero) {
-    nunck = map(throttleRAW, thZero, thMin - 100, 127, 0); //-100 to avoid running out of range
+#if BOOSTED_BMS && BOOSTED_BMS_DECODER
+  if (c == 'b' && boostedBmsValid()) {
+    const BoostedBmsData &bms = boostedBms();
+    Serial.printf("bms %.2f V, %.2f A, %u %%, cells %.3f-%.3f V, %d-%d C, faults %08x\n", bms.packVoltage,
+                  bms.packCurrent, bms.soc, bms.cellMin, bms.cellMax, bms.tempLow, bms.tempHigh, bms.faults);
   }
+#endif
+#if LATENCY_TRACE
+  if (c == 'l')
+    latencyReport(Serial);
+#endif
+  if (c == 'r') {
+    schedulerResetStats();
+#if LATENCY_TRACE
+    latencyReset();
+#endif
+  }
+}
 
-  if (digitalRead(brakeSw) == 1 && nunck > 127 && stopOnBrake == 1) {
-    nunck = 127; // interrupts acceleration when braking
+// WiFi, OTA, settings and serial console
+void serviceJob(uint32_t nowUs) {
+  configureWifi();
+  ArduinoOTA.handle();
+  webConfigHandle();
+  configService(nowUs / 1000);
+  odometerService(nowUs / 1000);
+  rideStatsService(nowUs / 1000);
+  vescSetupService(nowUs / 1000, erpm);
+
+  // serial, one command per line: "s" prints the scheduler statistics, "t" the telemetry polling, "b" the battery
+  // estimate, "o" the odometer, "l" the latency histograms, "r" resets them; "params", "get <name>", "set <name> <value>"
+  static String line;
+  while (Serial.available()) {
+    char ch = Serial.read();
+    if (ch != '\n' && ch != '\r') {
+      if (line.length() < 64)
+        line += ch;
+      continue;
+    }
+    if (line.length() == 0)
+      continue;
+    serialCommand(line);
+    line = "";
   }
+}
 
-  // send nunchuck value to VESC
-  if ((millis() - filterTime) > 1000 &&
-      filterDelay == 1) { // this delay prevents the motors from stuttering at start when applying the kalman filter
-    filterDelay = 0;
-    filterTime = millis();
+void loop() {
+  bool ran = schedulerRun();
+
+#if LATENCY_TRACE
+  if (latencyTxPending() && Vesc.txIdle()) {
+    latencyMark(LAT_TX_DONE, micros());
   }
-  else {
-    Vesc.nunchuck.valueY = nunck;
-    Vesc.setNunchuckValues();
+  if (latencyTxPending())
+    return; // keep polling for the TX-complete mark
+#endif
+
+  if (!ran) {
+    // nothing due: sleep until the next job or a touch interrupt, locked in light sleep
+    uint32_t idleUs = schedulerIdleUs();
+    bool touched = false;
+    if (!WIFI && !touchIsDown() && !lightsBusy() && powerSleep(idleUs, &touched)) {
+      if (touched) {
+        touchWakeup();
+        lightsWakeup();
+      }
+    }
+    else if (idleUs >= 1000) {
+      touched = waitTouch(idleUs / 1000);
+    }
+    if (touched)
+      schedulerSetPeriod(renderJobId, RENDER_PERIOD_US); // answer a touch at full frame rate
   }
-  drawScreen();
 }
@@ -0,0 +1,105 @@
+#include "odometer.h"
+#include <Preferences.h>
+
+struct OdoSlot {
+  uint64_t distQ32;
+  uint32_t seq;
+};
+
+static uint64_t stepQ32 = 0; // metres per tachometer step, Q32
+static uint64_t distQ32 = 0;
+static uint64_t sessionQ32 = 0;
+static uint64_t savedQ32 = 0;
+static uint32_t seq = 0;
+static bool tachoInit = false;
+static int32_t lastTacho = 0;
+static uint32_t lastMoveMs = 0;
+static uint32_t savedMs = 0;
+
+static const char *slotKey(uint8_t slot) {
+  static const char *keys[ODO_SLOTS] = {"s0", "s1", "s2", "s3"};
+  return keys[slot];
+}
+
+void odometerSetScale(float metersPerStep) {
+  stepQ32 = (uint64_t)((double)metersPerStep * 4294967296.0);
+}
+
+void odometerBegin(float metersPerStep) {
+  odometerSetScale(metersPerStep);
+
+  Preferences pref;
+  pref.begin("odometer", true);
+  for (uint8_t i = 0; i < ODO_SLOTS; i++) {
+    OdoSlot slot;
+    if (pref.getBytes(slotKey(i), &slot, sizeof(slot)) != sizeof(slot))
+      continue;
+    if (seq == 0 || (int32_t)(slot.seq - seq) > 0) {
+      seq = slot.seq;
+      distQ32 = slot.distQ32;
+    }
+  }
+  pref.end();
+  savedQ32 = distQ32;
+  savedMs = millis();
+}
+
+void odometerUpdate(int32_t tachometerAbs, uint32_t nowMs) {
+  if (!tachoInit) {
+    lastTacho = tachometerAbs;
+    lastMoveMs = nowMs;
+    tachoInit = true;
+    return;
+  }
+
+  // difference in uint32, a wrap-around of the counter stays a small positive step
+  int32_t delta = (int32_t)((uint32_t)tachometerAbs - (uint32_t)lastTacho);
+  lastTacho = tachometerAbs;
+  if (delta < 0) {
+    // VESC restarted, it counted from 0 again
+    delta = tachometerAbs >= 0 ? tachometerAbs : 0;
+  }
+  if (delta == 0)
+    return;
+
+  uint64_t stepDist = (uint64_t)delta * stepQ32;
+  if ((stepDist >> 32) > ODO_MAX_STEP_M)
+    return; // bad reply
+
+  distQ32 += stepDist;
+  sessionQ32 += stepDist;
+  lastMoveMs = nowMs;
+}
+
+static void commit(uint32_t nowMs) {
+  seq++;
+  OdoSlot slot = {distQ32, seq};
+  Preferences pref;
+  pref.begin("odometer", false);
+  pref.putBytes(slotKey(seq % ODO_SLOTS), &slot, sizeof(slot));
+  pref.end();
+  savedQ32 = distQ32;
+  savedMs = nowMs;
+}
+
+void odometerService(uint32_t nowMs) {
+  if (distQ32 == savedQ32)
+    return;
+  uint64_t unsavedM = (distQ32 - savedQ32) >> 32;
+  if (unsavedM >= ODO_COMMIT_M || (unsavedM > 0 && nowMs - savedMs >= ODO_COMMIT_MS) ||
+      (unsavedM >= ODO_IDLE_MIN_M && nowMs - lastMoveMs >= ODO_IDLE_MS))
+    commit(nowMs);
+}
+
+void odometerFlush() {
+  if (distQ32 != savedQ32)
+    commit(millis());
+}
+
+double odometerMeters() {
+  return distQ32 / 4294967296.0;
+}
+
+double odometerSessionMeters() {
+  return sessionQ32 / 4294967296.0;
+}
@@ -0,0 +1,46 @@
+#ifndef _ODOMETER_H
+#define _ODOMETER_H
+
+#include <Arduino.h>
+
+/*
+Lifetime odometer from the absolute tachometer of the VESC. Distance is kept in 64 bit fixed
+point (Q32 metres), VESC restarts and counter wrap-around are detected from the deltas.
+The value is written to NVS in batches (distance, time and standstill thresholds), rotating
+over several slots; the slot with the highest sequence number is loaded at start.
+The dashboard is not locked again once unlocked, a long standstill takes the place of the
+lock as the end of a ride; short stops in traffic do not write.
+*/
+
+#define ODO_SLOTS 4
+#define ODO_COMMIT_M 1000        // write after this distance
+#define ODO_COMMIT_MS 600000     // or after this time with unsaved distance
+#define ODO_IDLE_MS 60000        // or when standing still this long
+#define ODO_IDLE_MIN_M 100       // with at least this much unsaved distance
+#define ODO_MAX_STEP_M 1000      // larger deltas between two samples are dropped
+
+/**
+ * @brief      Load the odometer from NVS
+ * @param      metersPerStep  - Distance of one tachometer step
+ */
+void odometerBegin(float metersPerStep);
+
+// Change the distance of one tachometer step
+void odometerSetScale(float metersPerStep);
+
+// Absolute tachometer of a telemetry reply
+void odometerUpdate(int32_t tachometerAbs, uint32_t nowMs);
+
+// Write to NVS if a threshold is reached, call from a low priority job
+void odometerService(uint32_t nowMs);
+
+// Write unsaved distance now (before a restart)
+void odometerFlush();
+
+// Lifetime distance in m
+double odometerMeters();
+
+// Distance since start of the dashboard in m, survives VESC restarts
+double odometerSessionMeters();
+
+#endif
@@ -0,0 +1,141 @@
+#include "params.h"
+
+static const ParamDef *params = NULL;
+static uint8_t count = 0;
+static void (*changed)() = NULL;
+
+static uint8_t *field(uint8_t i) {
+  return (uint8_t *)&config() + params[i].offset;
+}
+
+static void store(uint8_t *p, ParamType type, float value) {
+  switch (type) {
+  case PARAM_INT: {
+    int32_t v = lroundf(value);
+    memcpy(p, &v, sizeof(v));
+    break;
+  }
+  case PARAM_FLOAT:
+    memcpy(p, &value, sizeof(value));
+    break;
+  case PARAM_BOOL:
+    *p = value != 0;
+    break;
+  }
+}
+
+void paramsBegin(const ParamDef *table, uint8_t n, void (*onChange)()) {
+  params = table;
+  count = n;
+  changed = onChange;
+
+  size_t loaded = configLoadedSize();
+  for (uint8_t i = 0; i < count; i++) {
+    if (params[i].offset >= loaded)
+      store((uint8_t *)&configEdit() + params[i].offset, params[i].type, params[i].def);
+  }
+}
+
+uint8_t paramCount() {
+  return count;
+}
+
+const ParamDef &paramDef(uint8_t i) {
+  return params[i];
+}
+
+int paramFind(const char *name) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(params[i].name, name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+float paramGet(uint8_t i) {
+  const uint8_t *p = field(i);
+  switch (params[i].type) {
+  case PARAM_INT: {
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case PARAM_FLOAT: {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case PARAM_BOOL:
+    return *p;
+  }
+  return 0;
+}
+
+bool paramSet(uint8_t i, float value) {
+  const ParamDef &d = params[i];
+  if (isnan(value) || value < d.min || value > d.max)
+    return false;
+  if (value == paramGet(i))
+    return true;
+  store((uint8_t *)&configEdit() + d.offset, d.type, value);
+  if (changed != NULL)
+    changed();
+  return true;
+}
+
+String paramText(uint8_t i, bool reveal) {
+  if ((params[i].flags & PARAM_SECRET) && !reveal)
+    return "****";
+  float v = paramGet(i);
+  if (params[i].type == PARAM_FLOAT)
+    return String(v, params[i].step < 0.1f ? 2 : 1);
+  return String((int32_t)v);
+}
+
+void paramsPrint(Print &out) {
+  for (uint8_t i = 0; i < count; i++) {
+    const ParamDef &d = params[i];
+    out.printf("%-14s %8s  (%g..%g, default %g)\n", d.name, paramText(i).c_str(), d.min, d.max,
+               (d.flags & PARAM_SECRET) ? 0.0f : d.def);
+  }
+}
+
+bool paramsCommand(const String &line, Print &out, bool allowSet, bool allowSecret) {
+  String cmd = line;
+  cmd.trim();
+  if (cmd == "params") {
+    paramsPrint(out);
+    return true;
+  }
+
+  bool set = cmd.startsWith("set ");
+  if (!set && !cmd.startsWith("get "))
+    return false;
+
+  String args = cmd.substring(4);
+  args.trim();
+  int space = args.indexOf(' ');
+  String name = space < 0 ? args : args.substring(0, space);
+  int i = paramFind(name.c_str());
+  if (i < 0) {
+    out.println("unknown parameter " + name);
+    return true;
+  }
+
+  if (set) {
+    if (!allowSet) {
+      out.println("unlock the dashboard and stop to change parameters");
+      return true;
+    }
+    if ((params[i].flags & PARAM_SECRET) && !allowSecret) {
+      out.println(String(params[i].name) + " can only be changed on the dashboard");
+      return true;
+    }
+    if (space < 0 || !paramSet(i, args.substring(space + 1).toFloat())) {
+      out.printf("%s: value out of range %g..%g\n", params[i].name, params[i].min, params[i].max);
+      return true;
+    }
+  }
+  out.println(String(params[i].name) + " = " + paramText(i));
+  return true;
+}
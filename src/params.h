@@ -0,0 +1,69 @@
+#ifndef _PARAMS_H
+#define _PARAMS_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include "configStore.h"
+
+/*
+Registry of the runtime parameters. Every entry names a field of ConfigData with its type,
+range, step and default; values are read from and written to the config blob, so they survive
+a restart. The table is handed over by main.cpp, the defaults come from config.h.
+*/
+
+enum ParamType {
+  PARAM_INT = 0, // int32_t field
+  PARAM_FLOAT,   // float field
+  PARAM_BOOL     // uint8_t field
+};
+
+#define PARAM_SECRET 0x01 // value is not listed (unlock codes)
+
+struct ParamDef {
+  const char *name;
+  ParamType type;
+  uint16_t offset; // in ConfigData
+  float min;
+  float max;
+  float step; // of the settings screen
+  float def;
+  uint8_t flags;
+};
+
+#define PARAM(name, type, field, min, max, step, def, flags) \
+  { name, type, offsetof(ConfigData, field), min, max, step, def, flags }
+
+/**
+ * @brief      Register the parameter table, fields missing in the stored blob get their default
+ * @param      table     - Parameter definitions, must stay valid
+ * @param      count     - Number of entries
+ * @param      onChange  - Called after a value changed, to recompute derived values
+ */
+void paramsBegin(const ParamDef *table, uint8_t count, void (*onChange)());
+
+uint8_t paramCount();
+const ParamDef &paramDef(uint8_t i);
+
+// Index of a parameter, -1 if unknown
+int paramFind(const char *name);
+
+float paramGet(uint8_t i);
+
+// Set a value within its range, false if out of range
+bool paramSet(uint8_t i, float value);
+
+// Value as text, secrets as "****" unless reveal is set
+String paramText(uint8_t i, bool reveal = false);
+
+// List all parameters with value and range
+void paramsPrint(Print &out);
+
+/**
+ * @brief      Text command: "params", "get <name>", "set <name> <value>"
+ * @param      allowSet     - False refuses "set" (locked or moving)
+ * @param      allowSecret  - False refuses "set" of PARAM_SECRET entries (remote clients)
+ * @return     False if the line is not a parameter command
+ */
+bool paramsCommand(const String &line, Print &out, bool allowSet, bool allowSecret = true);
+
+#endif
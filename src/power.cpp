@@ -0,0 +1,81 @@
+#include "power.h"
+#include "driver/gpio.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "sdkconfig.h"
+
+static PowerMode mode = POWER_RIDE;
+static uint8_t wakeGpio = 0;
+static uint8_t brakeGpio = 0;
+
+// dynamic frequency scaling, false if the SDK was built without power management
+static bool pmConfigure(int maxMhz, int minMhz) {
+#if CONFIG_PM_ENABLE && CONFIG_IDF_TARGET_ESP32S3
+  esp_pm_config_esp32s3_t pm;
+  pm.max_freq_mhz = maxMhz;
+  pm.min_freq_mhz = minMhz;
+  pm.light_sleep_enable = false; // light sleep is entered explicitly, see powerSleep()
+  return esp_pm_configure(&pm) == ESP_OK;
+#else
+  return false;
+#endif
+}
+
+void powerBegin(uint8_t wakePin, uint8_t brakePin) {
+  wakeGpio = wakePin;
+  brakeGpio = brakePin;
+  mode = POWER_RIDE;
+  if (!pmConfigure(POWER_RIDE_MHZ, POWER_RIDE_MHZ))
+    setCpuFrequencyMhz(POWER_RIDE_MHZ);
+}
+
+void powerSetMode(PowerMode m) {
+  if (m == mode)
+    return;
+  mode = m;
+  switch (mode) {
+  case POWER_RIDE:
+    if (!pmConfigure(POWER_RIDE_MHZ, POWER_RIDE_MHZ))
+      setCpuFrequencyMhz(POWER_RIDE_MHZ);
+    break;
+  case POWER_IDLE:
+    // scaled down between jobs, up to the idle clock while drawing
+    if (!pmConfigure(POWER_IDLE_MHZ, POWER_LOCKED_MHZ))
+      setCpuFrequencyMhz(POWER_IDLE_MHZ);
+    break;
+  case POWER_LOCKED:
+    if (!pmConfigure(POWER_LOCKED_MHZ, POWER_LOCKED_MHZ))
+      setCpuFrequencyMhz(POWER_LOCKED_MHZ);
+    break;
+  }
+}
+
+PowerMode powerMode() {
+  return mode;
+}
+
+bool powerSleep(uint32_t maxUs, bool *touched) {
+  *touched = false;
+#if POWER_LIGHT_SLEEP
+  if (mode != POWER_LOCKED || maxUs < POWER_SLEEP_MIN_US)
+    return false;
+  if (digitalRead(wakeGpio) == LOW || digitalRead(brakeGpio) == HIGH)
+    return false; // interrupt still active, it would end the sleep at once
+
+  esp_sleep_enable_timer_wakeup(maxUs - POWER_WAKE_US);
+  // the wake-up levels replace the edge interrupts of the pins for the time of the sleep
+  gpio_wakeup_enable((gpio_num_t)wakeGpio, GPIO_INTR_LOW_LEVEL);
+  gpio_wakeup_enable((gpio_num_t)brakeGpio, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_light_sleep_start();
+  gpio_wakeup_disable((gpio_num_t)wakeGpio);
+  gpio_wakeup_disable((gpio_num_t)brakeGpio);
+  gpio_set_intr_type((gpio_num_t)wakeGpio, GPIO_INTR_NEGEDGE);
+  gpio_set_intr_type((gpio_num_t)brakeGpio, GPIO_INTR_ANYEDGE);
+
+  *touched = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <Arduino.h>
+
+/*
+Power modes of the dashboard. The CPU clock follows the mode (with esp_pm dynamic frequency
+scaling where the SDK has it enabled, setCpuFrequencyMhz otherwise). While locked, gaps between
+jobs are spent in light sleep, woken by the timer of the next job, the touch interrupt or the
+brake switch. The lights keep their output (see lights.cpp), only a running fade or flash keeps
+the caller from sleeping.
+*/
+
+enum PowerMode {
+  POWER_RIDE = 0, // unlocked, content changing
+  POWER_IDLE,     // unlocked, nothing changed for a while
+  POWER_LOCKED
+};
+
+#define POWER_RIDE_MHZ 240
+#define POWER_IDLE_MHZ 160
+#define POWER_LOCKED_MHZ 80 // lowest clock with the 80 MHz APB (UART, TWAI and LEDC timing)
+
+#ifndef POWER_LIGHT_SLEEP
+  #if VESC_COMM_TYPE == 2
+    #define POWER_LIGHT_SLEEP 0 // a sleeping TWAI controller would not acknowledge the frames of the VESC
+  #else
+    #define POWER_LIGHT_SLEEP 1
+  #endif
+#endif
+#define POWER_SLEEP_MIN_US 3000 // shorter gaps are not worth entering light sleep
+#define POWER_WAKE_US 1000      // wake-up time, the sleep ends this much before the next job
+
+/**
+ * @brief      Set up the clock control
+ * @param      wakePin   - Touch interrupt pin (active low) that ends a light sleep
+ * @param      brakePin  - Brake switch (active high), ends a light sleep as well
+ */
+void powerBegin(uint8_t wakePin, uint8_t brakePin);
+
+void powerSetMode(PowerMode mode);
+PowerMode powerMode();
+
+/**
+ * @brief      Light sleep for the given time if the mode allows it
+ * @param      maxUs    - Time until the next job
+ * @param      touched  - Set if the touch interrupt or the brake switch ended the sleep
+ * @return     False if not slept, the caller waits as usual
+ */
+bool powerSleep(uint32_t maxUs, bool *touched);
+
+#endif
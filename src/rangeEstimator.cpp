@@ -0,0 +1,72 @@
+#include "rangeEstimator.h"
+
+#define BUCKETS_1KM (1000 / RANGE_BUCKET_M)
+#define MAX_STEP_M 1000  // a larger jump is a VESC restart or a bad reply
+#define MIN_WH_PER_KM 1.0f // less is downhill or regen, no usable range
+
+RangeEstimator::RangeEstimator(void) {
+  memset(_buckets, 0, sizeof(_buckets));
+}
+
+void RangeEstimator::pushBucket(int32_t mWh) {
+  if (_count >= BUCKETS_1KM)
+    _sum1km -= _buckets[(_head + RANGE_BUCKETS - BUCKETS_1KM) % RANGE_BUCKETS];
+  if (_count == RANGE_BUCKETS)
+    _sum5km -= _buckets[_head];
+  _buckets[_head] = mWh;
+  _sum1km += mWh;
+  _sum5km += mWh;
+  _head = (_head + 1) % RANGE_BUCKETS;
+  if (_count < RANGE_BUCKETS)
+    _count++;
+}
+
+void RangeEstimator::update(float wattHours, float wattHoursCharged, float distM) {
+  int32_t mWh = (wattHours - wattHoursCharged) * 1000;
+  if (!_init) {
+    _lastMWh = mWh;
+    _lastM = distM;
+    _init = true;
+    return;
+  }
+
+  int32_t dMWh = mWh - _lastMWh;
+  float dM = distM - _lastM;
+  _lastMWh = mWh;
+  _lastM = distM;
+  if (dM < 0 || dM > MAX_STEP_M)
+    return; // counters restarted, continue from the new values
+
+  _rideMWh += dMWh;
+  _rideM += dM;
+  _bucketMWh += dMWh;
+  _bucketM += dM;
+
+  // close full buckets, split the energy if one sample spans several
+  while (_bucketM >= RANGE_BUCKET_M) {
+    int32_t part = _bucketMWh * (RANGE_BUCKET_M / _bucketM);
+    pushBucket(part);
+    _bucketMWh -= part;
+    _bucketM -= RANGE_BUCKET_M;
+  }
+}
+
+float RangeEstimator::whPerKm(RangeWindow window) {
+  if (window == RANGE_RIDE) {
+    if (_rideM < RANGE_BUCKET_M)
+      return 0;
+    return _rideMWh / _rideM; // mWh/m = Wh/km
+  }
+  uint8_t n = window == RANGE_1KM ? min((int)_count, BUCKETS_1KM) : _count;
+  if (n == 0)
+    return 0;
+  int32_t sum = window == RANGE_1KM ? _sum1km : _sum5km;
+  return (float)sum / (n * RANGE_BUCKET_M);
+}
+
+float RangeEstimator::rangeKm(float remainingWh) {
+  float use = _count >= BUCKETS_1KM ? whPerKm(RANGE_5KM) : whPerKm(RANGE_RIDE);
+  if (use < MIN_WH_PER_KM || remainingWh <= 0)
+    return -1;
+  return remainingWh / use;
+}
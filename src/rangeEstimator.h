@@ -0,0 +1,63 @@
+#ifndef _RANGEESTIMATOR_H
+#define _RANGEESTIMATOR_H
+
+#include <Arduino.h>
+
+/*
+Energy use per distance from the VESC watt-hour counters and the absolute tachometer distance.
+Energy is collected in 100 m buckets in a ring buffer; the 1 km and 5 km windows keep running
+sums, so every sample is O(1). Energy is held in integer mWh, the sums do not drift.
+*/
+
+#define RANGE_BUCKET_M 100
+#define RANGE_BUCKETS 50 // 5 km
+
+enum RangeWindow {
+  RANGE_1KM = 0,
+  RANGE_5KM,
+  RANGE_RIDE
+};
+
+class RangeEstimator {
+public:
+  RangeEstimator(void);
+
+  /**
+   * @brief      Add a sample, counters of the same telemetry reply
+   * @param      wattHours         - Energy used since VESC start
+   * @param      wattHoursCharged  - Energy regenerated since VESC start
+   * @param      distM             - Distance since VESC start in m
+   */
+  void update(float wattHours, float wattHoursCharged, float distM);
+
+  /**
+   * @brief      Energy use of a window in Wh/km
+   * @return     0 if less than 100 m were ridden
+   */
+  float whPerKm(RangeWindow window);
+
+  /**
+   * @brief      Range left with the energy use of the last 5 km (the ride while shorter than 1 km)
+   * @param      remainingWh  - Energy left in the battery
+   * @return     Range in km, -1 if unknown
+   */
+  float rangeKm(float remainingWh);
+
+private:
+  int32_t _buckets[RANGE_BUCKETS]; // mWh per 100 m
+  uint8_t _head = 0;               // next bucket to write
+  uint8_t _count = 0;
+  int32_t _sum1km = 0;
+  int32_t _sum5km = 0;
+  bool _init = false;
+  int32_t _lastMWh = 0;
+  float _lastM = 0;
+  int32_t _bucketMWh = 0;
+  float _bucketM = 0;
+  int64_t _rideMWh = 0;
+  float _rideM = 0;
+
+  void pushBucket(int32_t mWh);
+};
+
+#endif
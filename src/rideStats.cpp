@@ -0,0 +1,136 @@
+#include "rideStats.h"
+#include <Preferences.h>
+
+#define MAX_DT_MS 2000 // longer gaps between samples are not counted as ride time
+
+static bool started = false; // moved at least once
+static bool sampled = false;
+static uint32_t lastMs = 0;
+static uint32_t lastMoveMs = 0;
+static uint32_t savedMs = 0; // last store of the summary
+static uint32_t rideMs = 0;
+static uint32_t movingMs = 0;
+static float distM = 0;
+static float maxSpeed = 0;
+static uint32_t speedN = 0; // Welford
+static float speedMean = 0;
+static float speedM2 = 0;
+static float whUsed = 0;
+static float whRegen = 0;
+static float lastWh = 0;
+static float lastWhCharged = 0;
+static float peakMotorA = 0;
+static float peakBattA = 0;
+static float peakRegenA = 0;
+static float maxPowerW = 0;
+static float maxTempFet = RIDE_TEMP_NONE;
+static float maxTempMotor = RIDE_TEMP_NONE;
+static bool dirty = false;
+static bool hasLast = false;
+static RideSummary lastRide;
+
+void rideStatsBegin() {
+  Preferences pref;
+  pref.begin("rideStats", true);
+  hasLast = pref.getBytes("last", &lastRide, sizeof(lastRide)) == sizeof(lastRide);
+  pref.end();
+}
+
+void rideStatsUpdate(const RideSample &s, uint32_t nowMs) {
+  if (!sampled) {
+    lastWh = s.wattHours;
+    lastWhCharged = s.wattHoursCharged;
+    lastMs = nowMs;
+    sampled = true;
+    return;
+  }
+
+  uint32_t dtMs = nowMs - lastMs;
+  lastMs = nowMs;
+  if (dtMs > MAX_DT_MS)
+    dtMs = 0;
+
+  bool moving = s.speed >= RIDE_MOVING_KMH;
+  if (moving) {
+    started = true;
+    dirty = true;
+    lastMoveMs = nowMs;
+    movingMs += dtMs;
+    distM += s.speed * dtMs / 3600.0f;
+
+    // Welford running mean and variance
+    speedN++;
+    float d = s.speed - speedMean;
+    speedMean += d / speedN;
+    speedM2 += d * (s.speed - speedMean);
+  }
+  if (started)
+    rideMs += dtMs;
+
+  // energy from the counter deltas, a VESC restart starts them at 0 again
+  float dWh = s.wattHours - lastWh;
+  float dWhCharged = s.wattHoursCharged - lastWhCharged;
+  lastWh = s.wattHours;
+  lastWhCharged = s.wattHoursCharged;
+  if (dWh > 0)
+    whUsed += dWh;
+  if (dWhCharged > 0)
+    whRegen += dWhCharged;
+
+  maxSpeed = max(maxSpeed, s.speed);
+  peakMotorA = max(peakMotorA, fabsf(s.motorCurrent));
+  peakBattA = max(peakBattA, s.inputCurrent);
+  peakRegenA = min(peakRegenA, s.inputCurrent);
+  maxPowerW = max(maxPowerW, s.voltage * s.inputCurrent);
+  maxTempFet = max(maxTempFet, s.tempFet);
+  maxTempMotor = max(maxTempMotor, s.tempMotor);
+}
+
+static uint16_t clampU16(float v) {
+  return v <= 0 ? 0 : (v >= 65535 ? 65535 : (uint16_t)(v + 0.5f));
+}
+
+static int16_t clampI16(float v) {
+  return v <= -32768 ? -32768 : (v >= 32767 ? 32767 : (int16_t)lroundf(v));
+}
+
+void rideStatsSummary(RideSummary *out) {
+  out->rideS = rideMs / 1000;
+  out->movingS = movingMs / 1000;
+  out->distM = distM;
+  out->maxSpeed = clampU16(maxSpeed * 10);
+  out->avgSpeed = movingMs > 0 ? clampU16(distM * 36000.0f / movingMs) : 0; // m/ms to 0.1 km/h
+  out->speedSd = speedN > 1 ? clampU16(sqrtf(speedM2 / (speedN - 1)) * 10) : 0;
+  out->whUsed = clampU16(whUsed * 10);
+  out->whRegen = clampU16(whRegen * 10);
+  out->peakMotorA = clampI16(peakMotorA);
+  out->peakBattA = clampI16(peakBattA);
+  out->peakRegenA = clampI16(peakRegenA);
+  out->maxPowerW = clampU16(maxPowerW);
+  out->maxTempFet = constrain((int)maxTempFet, -128, 127);
+  out->maxTempMotor = constrain((int)maxTempMotor, -128, 127);
+}
+
+void rideStatsSave() {
+  savedMs = millis();
+  if (!dirty)
+    return;
+  RideSummary summary;
+  rideStatsSummary(&summary);
+  Preferences pref;
+  pref.begin("rideStats", false);
+  pref.putBytes("last", &summary, sizeof(summary));
+  pref.end();
+  dirty = false;
+}
+
+void rideStatsService(uint32_t nowMs) {
+  if (dirty && (nowMs - lastMoveMs >= RIDE_SAVE_IDLE_MS || nowMs - savedMs >= RIDE_SAVE_MS))
+    rideStatsSave();
+}
+
+bool rideStatsLast(RideSummary *out) {
+  if (hasLast)
+    *out = lastRide;
+  return hasLast;
+}
@@ -0,0 +1,65 @@
+#ifndef _RIDESTATS_H
+#define _RIDESTATS_H
+
+#include <Arduino.h>
+
+/*
+Per ride statistics from the telemetry snapshot. Every sample is O(1): running sums, maxima
+and a Welford mean/variance of the moving speed. The ride summary is a fixed size record,
+loaded at start as the last ride. A ride lasts from the first move after power on until the
+power is cut; the dashboard is not locked again, so the record is stored in NVS after a long
+standstill (the likely end) and periodically while riding, each time overwriting the same key.
+*/
+
+#define RIDE_MOVING_KMH 1.0f  // slower counts as standing
+#define RIDE_SAVE_IDLE_MS 300000 // store the summary after standing still this long
+#define RIDE_SAVE_MS 600000      // and at least this often while it changes
+
+struct RideSample {
+  float speed;        // km/h
+  float motorCurrent; // A
+  float inputCurrent; // A, battery side
+  float voltage;
+  float tempFet;
+  float tempMotor;
+  float wattHours;        // VESC counters since its start
+  float wattHoursCharged;
+};
+
+#define RIDE_TEMP_NONE -128 // no temperature sampled yet
+
+struct RideSummary {
+  uint32_t rideS;   // from the first move to the last sample
+  uint32_t movingS;
+  uint32_t distM;
+  uint16_t maxSpeed; // 0.1 km/h
+  uint16_t avgSpeed; // 0.1 km/h, while moving
+  uint16_t speedSd;  // 0.1 km/h, standard deviation while moving
+  uint16_t whUsed;   // 0.1 Wh
+  uint16_t whRegen;  // 0.1 Wh
+  int16_t peakMotorA;
+  int16_t peakBattA;
+  int16_t peakRegenA; // most negative battery current
+  uint16_t maxPowerW;
+  int8_t maxTempFet;   // RIDE_TEMP_NONE until the first sample
+  int8_t maxTempMotor; // RIDE_TEMP_NONE until the first sample
+};
+
+// Load the last ride from NVS
+void rideStatsBegin();
+
+void rideStatsUpdate(const RideSample &sample, uint32_t nowMs);
+
+// Store the summary after a long standstill or RIDE_SAVE_MS, call from a low priority job
+void rideStatsService(uint32_t nowMs);
+
+// Store the summary now if something changed
+void rideStatsSave();
+
+// Summary of the current ride
+void rideStatsSummary(RideSummary *out);
+
+// Summary of the last stored ride before this start, false if none
+bool rideStatsLast(RideSummary *out);
+
+#endif
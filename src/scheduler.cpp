@@ -0,0 +1,111 @@
+#include "scheduler.h"
+
+struct Job {
+  const char *name;
+  JobFunc func;
+  uint32_t periodUs;
+  uint32_t budgetUs;
+  uint32_t nextUs;
+  uint8_t priority;
+  JobStats stats;
+};
+
+static Job jobs[SCHEDULER_MAX_JOBS];
+static int jobCount = 0;
+
+int schedulerAdd(const char *name, JobFunc func, uint32_t periodUs, uint8_t priority, uint32_t budgetUs) {
+  if (jobCount >= SCHEDULER_MAX_JOBS)
+    return -1;
+  Job &j = jobs[jobCount];
+  j.name = name;
+  j.func = func;
+  j.periodUs = periodUs;
+  j.budgetUs = budgetUs;
+  j.priority = priority;
+  j.nextUs = micros();
+  memset(&j.stats, 0, sizeof(j.stats));
+  return jobCount++;
+}
+
+void schedulerSetPeriod(int id, uint32_t periodUs) {
+  if (id < 0 || id >= jobCount || jobs[id].periodUs == periodUs)
+    return;
+  jobs[id].nextUs += periodUs - jobs[id].periodUs;
+  jobs[id].periodUs = periodUs;
+}
+
+bool schedulerRun() {
+  uint32_t now = micros();
+  Job *due = NULL;
+
+  for (int i = 0; i < jobCount; i++) {
+    Job &j = jobs[i];
+    if ((int32_t)(now - j.nextUs) < 0)
+      continue;
+    // most important first, the longest waiting of equal priority
+    if (due == NULL || j.priority > due->priority ||
+        (j.priority == due->priority && (int32_t)(due->nextUs - j.nextUs) > 0)) {
+      due = &j;
+    }
+  }
+  if (due == NULL)
+    return false;
+
+  // fixed rate, but do not run missed periods back to back
+  uint32_t late = now - due->nextUs;
+  if (late >= due->periodUs) {
+    due->stats.skipped += late / due->periodUs;
+    due->nextUs = now + due->periodUs;
+  }
+  else {
+    due->nextUs += due->periodUs;
+  }
+
+  due->func(now);
+
+  uint32_t runtime = micros() - now;
+  JobStats &s = due->stats;
+  s.runs++;
+  s.lastUs = runtime;
+  s.totalUs += runtime;
+  if (runtime > s.maxUs)
+    s.maxUs = runtime;
+  if (runtime > due->budgetUs)
+    s.overruns++;
+  return true;
+}
+
+uint32_t schedulerIdleUs() {
+  uint32_t now = micros();
+  uint32_t idle = UINT32_MAX;
+  for (int i = 0; i < jobCount; i++) {
+    int32_t left = jobs[i].nextUs - now;
+    if (left <= 0)
+      return 0;
+    if ((uint32_t)left < idle)
+      idle = left;
+  }
+  return idle;
+}
+
+const JobStats *schedulerStats(int id) {
+  if (id < 0 || id >= jobCount)
+    return NULL;
+  return &jobs[id].stats;
+}
+
+void schedulerReport(Print &out) {
+  out.println("job        period  budget    runs   avg us   max us  overrun  skipped");
+  for (int i = 0; i < jobCount; i++) {
+    const Job &j = jobs[i];
+    uint32_t avg = j.stats.runs ? j.stats.totalUs / j.stats.runs : 0;
+    out.printf("%-9s %7u %7u %7u %8u %8u %8u %8u\n", j.name, j.periodUs, j.budgetUs, j.stats.runs, avg,
+               j.stats.maxUs, j.stats.overruns, j.stats.skipped);
+  }
+}
+
+void schedulerResetStats() {
+  for (int i = 0; i < jobCount; i++) {
+    memset(&jobs[i].stats, 0, sizeof(jobs[i].stats));
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <Arduino.h>
+
+/*
+Cooperative periodic scheduler for loop(). Every job has its own period, priority and time budget.
+Each call to schedulerRun() executes the most important due job; jobs that fall behind skip
+missed periods instead of running back to back.
+*/
+
+#define SCHEDULER_MAX_JOBS 8
+
+typedef void (*JobFunc)(uint32_t nowUs);
+
+struct JobStats {
+  uint32_t runs;
+  uint32_t overruns; // runtime above the budget
+  uint32_t skipped;  // periods missed because the job started too late
+  uint32_t lastUs;   // runtime of the last run
+  uint32_t maxUs;
+  uint64_t totalUs;
+};
+
+/**
+ * @brief      Register a job
+ * @param      name      - Name for the statistics
+ * @param      func      - Job function
+ * @param      periodUs  - Run period
+ * @param      priority  - Higher runs first when several jobs are due
+ * @param      budgetUs  - Expected max runtime, longer runs count as overrun
+ * @return     Job id, -1 if the table is full
+ */
+int schedulerAdd(const char *name, JobFunc func, uint32_t periodUs, uint8_t priority, uint32_t budgetUs);
+
+// Change the period of a job, the next run is rescheduled from the last one
+void schedulerSetPeriod(int id, uint32_t periodUs);
+
+// Run the most important due job, returns false if nothing was due
+bool schedulerRun();
+
+// Time until the next job is due
+uint32_t schedulerIdleUs();
+
+const JobStats *schedulerStats(int id);
+
+// Print runtime and overrun statistics of all jobs
+void schedulerReport(Print &out);
+void schedulerResetStats();
+
+#endif
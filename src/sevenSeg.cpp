@@ -0,0 +1,78 @@
+#include "sevenSeg.h"
+
+// segments of 0-9
+static const uint8_t digitSegments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+SevenSeg::SevenSeg(const SegLine *segs, int16_t half, int16_t width, int16_t height, int16_t pitch, uint8_t digits)
+    : _segs(segs), _half(half), _width(width), _height(height), _pitch(pitch) {
+  _digits = digits > SEVENSEG_MAX_DIGITS ? SEVENSEG_MAX_DIGITS : digits;
+  memset(_drawn, 0, sizeof(_drawn));
+}
+
+void SevenSeg::setColors(uint16_t on, uint16_t ghost, uint16_t background) {
+  _on = on;
+  _ghost = ghost;
+  _background = background;
+  _valid = false;
+}
+
+void SevenSeg::invalidate() {
+  _valid = false;
+}
+
+bool SevenSeg::valid() const {
+  return _valid;
+}
+
+int16_t SevenSeg::totalWidth() const {
+  return (_digits - 1) * _pitch + _width;
+}
+
+void SevenSeg::fillSegment(TFT_eSPI &gfx, int16_t x, int16_t y, const SegLine &s, uint16_t color) {
+  int16_t h = _half;
+  int16_t x0 = x + s.x0, y0 = y + s.y0, x1 = x + s.x1, y1 = y + s.y1;
+  if (y0 == y1) {
+    // horizontal: bar between the pointed ends
+    gfx.fillRect(x0 + h + 1, y0 - h, x1 - x0 - 2 * h - 1, 2 * h + 1, color);
+    gfx.fillTriangle(x0, y0, x0 + h, y0 - h, x0 + h, y0 + h, color);
+    gfx.fillTriangle(x1, y1, x1 - h, y1 - h, x1 - h, y1 + h, color);
+  }
+  else {
+    gfx.fillRect(x0 - h, y0 + h + 1, 2 * h + 1, y1 - y0 - 2 * h - 1, color);
+    gfx.fillTriangle(x0, y0, x0 - h, y0 + h, x0 + h, y0 + h, color);
+    gfx.fillTriangle(x1, y1, x1 - h, y1 - h, x1 + h, y1 - h, color);
+  }
+}
+
+void SevenSeg::draw(TFT_eSPI &gfx, int16_t x, int16_t y, int value) {
+  uint8_t want[SEVENSEG_MAX_DIGITS];
+  memset(want, 0, sizeof(want));
+  if (value >= 0) {
+    for (int d = _digits - 1; d >= 0; d--) {
+      want[d] = digitSegments[value % 10];
+      value /= 10;
+      if (value == 0)
+        break;
+    }
+  }
+
+  if (!_valid) {
+    gfx.fillRect(x, y, totalWidth(), _height, _background);
+    memset(_drawn, 0, sizeof(_drawn));
+    if (_ghost != _background) {
+      for (uint8_t d = 0; d < _digits; d++)
+        for (uint8_t i = 0; i < 7; i++)
+          fillSegment(gfx, x + d * _pitch, y, _segs[i], _ghost);
+    }
+    _valid = true;
+  }
+
+  for (uint8_t d = 0; d < _digits; d++) {
+    uint8_t changed = want[d] ^ _drawn[d];
+    for (uint8_t i = 0; changed != 0; i++, changed >>= 1) {
+      if (changed & 1)
+        fillSegment(gfx, x + d * _pitch, y, _segs[i], (want[d] >> i & 1) ? _on : _ghost);
+    }
+    _drawn[d] = want[d];
+  }
+}
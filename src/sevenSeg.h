@@ -0,0 +1,92 @@
+#ifndef _SEVENSEG_H
+#define _SEVENSEG_H
+
+#include "TFT_eSPI.h"
+#include <Arduino.h>
+
+/*
+Seven-segment digits drawn with plain fills (one rectangle and two triangles per segment), no font.
+The segment geometry is computed by the compiler for the digit height, the renderer remembers
+the segments on screen and only fills the ones that changed. Unlit segments can be drawn in a
+"ghost" color. Segments: a top, b top right, c bottom right, d bottom, e bottom left,
+f top left, g middle (bits 0-6).
+*/
+
+#define SEVENSEG_MAX_DIGITS 4
+
+// centre line of a segment, relative to the digit, ends are pointed
+struct SegLine {
+  int16_t x0, y0, x1, y1;
+};
+
+template <int H> struct SevenSegGeometry {
+  static constexpr int height = H;
+  static constexpr int width = H * 18 / 25;
+  static constexpr int half = H / 16; // half the bar thickness
+  static constexpr int gap = 2;       // between neighbouring segments
+  static constexpr int left = half;
+  static constexpr int right = width - 1 - half;
+  static constexpr int top = half;
+  static constexpr int mid = (H - 1) / 2;
+  static constexpr int bottom = H - 1 - half;
+  static constexpr SegLine seg[7] = {
+      {left + gap, top, right - gap, top},       // a
+      {right, top + gap, right, mid - gap},      // b
+      {right, mid + gap, right, bottom - gap},   // c
+      {left + gap, bottom, right - gap, bottom}, // d
+      {left, mid + gap, left, bottom - gap},     // e
+      {left, top + gap, left, mid - gap},        // f
+      {left + gap, mid, right - gap, mid}        // g
+  };
+};
+
+template <int H> constexpr SegLine SevenSegGeometry<H>::seg[7];
+
+class SevenSeg {
+public:
+  /**
+   * @brief      Digits of one geometry
+   * @param      segs    - SevenSegGeometry<H>::seg
+   * @param      half    - SevenSegGeometry<H>::half
+   * @param      width   - SevenSegGeometry<H>::width
+   * @param      height  - SevenSegGeometry<H>::height
+   * @param      pitch   - Distance between the left edges of two digits
+   * @param      digits  - Number of digits, at most SEVENSEG_MAX_DIGITS
+   */
+  SevenSeg(const SegLine *segs, int16_t half, int16_t width, int16_t height, int16_t pitch, uint8_t digits);
+
+  void setColors(uint16_t on, uint16_t ghost, uint16_t background);
+
+  // The area was overwritten, the next draw clears it and draws every segment
+  void invalidate();
+
+  // True while the screen shows what was drawn last
+  bool valid() const;
+
+  /**
+   * @brief      Draw a number right aligned without leading zeros, only changed segments are filled
+   * @param      x, y   - Top left corner of the first digit
+   * @param      value  - Number to show, negative blanks all digits
+   */
+  void draw(TFT_eSPI &gfx, int16_t x, int16_t y, int value);
+
+  // Width of all digits
+  int16_t totalWidth() const;
+
+private:
+  void fillSegment(TFT_eSPI &gfx, int16_t x, int16_t y, const SegLine &s, uint16_t color);
+
+  const SegLine *_segs;
+  int16_t _half;
+  int16_t _width;
+  int16_t _height;
+  int16_t _pitch;
+  uint8_t _digits;
+  uint16_t _on = TFT_WHITE;
+  uint16_t _ghost = TFT_BLACK;
+  uint16_t _background = TFT_BLACK;
+  uint8_t _drawn[SEVENSEG_MAX_DIGITS]; // segment masks on screen
+  bool _valid = false;
+};
+
+#endif
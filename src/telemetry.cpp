@@ -0,0 +1,107 @@
+#include "telemetry.h"
+
+struct TelemetryTier {
+  uint32_t mask;
+  uint32_t periodMs;
+  uint32_t lastMs;
+  uint32_t polls;
+  uint32_t fails;
+};
+
+static VescComms *vescPort = NULL;
+static TelemetryTier tiers[TELEM_CLASSES];
+static uint32_t rateBytes = 0;
+static uint32_t rateStartMs = 0;
+static uint32_t busRate = 0;
+static bool splitPolls = false; // a merged request failed, due classes are requested one per poll
+
+void telemetryBegin(VescComms *vesc) {
+  vescPort = vesc;
+  memset(tiers, 0, sizeof(tiers));
+  rateBytes = vesc->busBytes();
+  rateStartMs = millis();
+}
+
+void telemetrySetClass(TelemetryClass cls, uint32_t mask, uint32_t periodMs) {
+  tiers[cls].mask = mask;
+  tiers[cls].periodMs = periodMs;
+  tiers[cls].lastMs = millis() - periodMs; // due right away
+}
+
+static void updateBusRate(uint32_t nowMs) {
+  uint32_t dt = nowMs - rateStartMs;
+  if (dt < 1000)
+    return;
+  uint32_t bytes = vescPort->busBytes();
+  busRate = (uint64_t)(bytes - rateBytes) * 1000 / dt;
+  rateBytes = bytes;
+  rateStartMs = nowMs;
+}
+
+// fields of the due classes, only the first one (highest rate) with single
+static uint32_t dueMask(uint32_t nowMs, bool single, int *classes) {
+  uint32_t mask = 0;
+  *classes = 0;
+  for (int i = 0; i < TELEM_CLASSES; i++) {
+    TelemetryTier &t = tiers[i];
+    if (t.mask == 0 || nowMs - t.lastMs < t.periodMs)
+      continue;
+    mask |= t.mask;
+    (*classes)++;
+    if (single)
+      break;
+  }
+  return mask;
+}
+
+uint32_t telemetryPoll(uint32_t nowMs) {
+  if (vescPort == NULL)
+    return 0;
+  updateBusRate(nowMs);
+
+  int classes;
+  uint32_t mask = dueMask(nowMs, splitPolls, &classes);
+  if (mask == 0)
+    return 0;
+
+  vescPort->getVescValuesSelective(mask);
+  // what was decoded, over CAN the reply to an earlier request
+  uint32_t fields = vescPort->takeValuesMask();
+  bool ok = (fields & mask) == mask;
+  for (int i = 0; i < TELEM_CLASSES; i++) {
+    TelemetryTier &t = tiers[i];
+    if (t.mask == 0)
+      continue;
+    bool served = (fields & t.mask) == t.mask;
+    if (served)
+      t.lastMs = nowMs;
+    if ((mask & t.mask) != t.mask)
+      continue;
+    t.polls++;
+    if (!served) {
+      t.fails++;
+      // a class failing on its own waits for its next period instead of holding back the others
+      if (classes == 1)
+        t.lastMs = nowMs;
+    }
+  }
+  if (!ok && classes > 1)
+    splitPolls = true; // the merged request is retried class by class
+  else if (ok && classes == 1 && dueMask(nowMs, true, &classes) == 0)
+    splitPolls = false;
+  return fields;
+}
+
+uint32_t telemetryBusRate() {
+  return busRate;
+}
+
+void telemetryReport(Print &out) {
+  static const char *names[TELEM_CLASSES] = {"fast", "slow", "page"};
+  out.println("class       mask  period   polls   fails");
+  for (int i = 0; i < TELEM_CLASSES; i++) {
+    const TelemetryTier &t = tiers[i];
+    out.printf("%-6s %9x %7u %7u %7u\n", names[i], t.mask, t.periodMs, t.polls, t.fails);
+  }
+  out.printf("bus %u bytes/s\n", busRate);
+}
@@ -0,0 +1,59 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <Arduino.h>
+#include "VescComms.h"
+
+/*
+Tiered VESC telemetry polling. Fields are grouped in classes with their own period, each poll
+requests only the fields that are due with COMM_GET_VALUES_SELECTIVE. Due classes are merged
+into one request, so a slow field costs no extra round trip. After a merged request failed the
+due classes are requested one per poll until they caught up, a class failing on its own is
+retried with its next period.
+The page class follows the visible dashboard page, its diagnostics are not polled while riding.
+*/
+
+// COMM_GET_VALUES_SELECTIVE mask bits
+#define TELEM_TEMP_FET (1UL << 0)
+#define TELEM_TEMP_MOTOR (1UL << 1)
+#define TELEM_MOTOR_CURRENT (1UL << 2)
+#define TELEM_INPUT_CURRENT (1UL << 3)
+#define TELEM_ID_CURRENT (1UL << 4)
+#define TELEM_IQ_CURRENT (1UL << 5)
+#define TELEM_DUTY (1UL << 6)
+#define TELEM_RPM (1UL << 7)
+#define TELEM_VOLTAGE (1UL << 8)
+#define TELEM_AH (1UL << 9)
+#define TELEM_AH_CHARGED (1UL << 10)
+#define TELEM_WH (1UL << 11)
+#define TELEM_WH_CHARGED (1UL << 12)
+#define TELEM_TACHO (1UL << 13)
+#define TELEM_TACHO_ABS (1UL << 14)
+#define TELEM_FAULT (1UL << 15)
+
+enum TelemetryClass {
+  TELEM_FAST = 0, // rpm, currents, voltage, tachometer
+  TELEM_SLOW = 1, // temperatures, energy counters, odometer, fault
+  TELEM_PAGE = 2, // fields only the visible dashboard page shows
+  TELEM_CLASSES = 3
+};
+
+void telemetryBegin(VescComms *vesc);
+
+// Fields and poll period of a class, mask 0 disables the class
+void telemetrySetClass(TelemetryClass cls, uint32_t mask, uint32_t periodMs);
+
+/**
+ * @brief      Request the fields of all due classes
+ * @param      nowMs  - Current time
+ * @return     Mask of the fields decoded by this poll, 0 if nothing was due or no reply came in
+ */
+uint32_t telemetryPoll(uint32_t nowMs);
+
+// Bus bytes per second, averaged over the last second
+uint32_t telemetryBusRate();
+
+// Print periods, poll counts and bus load
+void telemetryReport(Print &out);
+
+#endif
@@ -0,0 +1,168 @@
+#include "throttleAdc.h"
+
+#if THROTTLE_ADC_DMA
+  #include "driver/adc.h"
+  #if THROTTLE_ADC_CALIBRATE
+    #include "esp_adc_cal.h"
+  #endif
+#endif
+
+#define ADC_FRAME_BYTES 256 // 64 results per DMA interrupt
+#define ADC_BLOCK_LEN (THROTTLE_ADC_SAMPLE_HZ / THROTTLE_ADC_OUTPUT_HZ)
+#define ADC_REJECT_FACTOR 3 // samples further than 3x the mean deviation are outliers
+#define ADC_FULL_SCALE_MV 3100
+
+static uint8_t adcPin;
+static bool dmaRunning = false;
+static volatile uint16_t lastValue = 0;
+static volatile uint32_t lastTime = 0;
+static volatile uint32_t lastSeq = 0;
+static uint32_t readSeq = 0;
+static portMUX_TYPE adcMux = portMUX_INITIALIZER_UNLOCKED;
+
+#if THROTTLE_ADC_DMA
+static uint16_t block[ADC_BLOCK_LEN];
+static uint16_t blockLen = 0;
+static uint8_t adcChannel;
+  #if THROTTLE_ADC_CALIBRATE
+static esp_adc_cal_characteristics_t adcChars;
+static bool adcCalibrated = false;
+  #endif
+
+// mean of the block without outliers
+static uint16_t decimate() {
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < blockLen; i++) {
+    sum += block[i];
+  }
+  int32_t mean = sum / blockLen;
+
+  uint32_t dev = 0;
+  for (uint16_t i = 0; i < blockLen; i++) {
+    dev += abs(block[i] - mean);
+  }
+  int32_t limit = (dev / blockLen) * ADC_REJECT_FACTOR + 1;
+
+  uint32_t keptSum = 0;
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < blockLen; i++) {
+    if (abs(block[i] - mean) <= limit) {
+      keptSum += block[i];
+      kept++;
+    }
+  }
+  uint32_t value = kept > 0 ? (keptSum + kept / 2) / kept : mean;
+
+  #if THROTTLE_ADC_CALIBRATE
+  if (adcCalibrated) {
+    // keep the 0-4095 scale, the calibrated throttle values stay comparable
+    value = esp_adc_cal_raw_to_voltage(value, &adcChars) * 4095 / ADC_FULL_SCALE_MV;
+    if (value > 4095)
+      value = 4095;
+  }
+  #endif
+  return value;
+}
+
+static void adcTask(void *arg) {
+  uint8_t frame[ADC_FRAME_BYTES];
+
+  for (;;) {
+    uint32_t len = 0;
+    if (adc_digi_read_bytes(frame, ADC_FRAME_BYTES, &len, 100) != ESP_OK)
+      continue;
+
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      adc_digi_output_data_t *p = (adc_digi_output_data_t *)&frame[i];
+      if (p->type2.channel != adcChannel)
+        continue;
+      block[blockLen++] = p->type2.data;
+
+      if (blockLen == ADC_BLOCK_LEN) {
+        uint16_t value = decimate();
+        blockLen = 0;
+        portENTER_CRITICAL(&adcMux);
+        lastValue = value;
+        lastTime = micros();
+        lastSeq++;
+        portEXIT_CRITICAL(&adcMux);
+      }
+    }
+  }
+}
+#endif
+
+void throttleAdcBegin(uint8_t pin) {
+  adcPin = pin;
+#if THROTTLE_ADC_DMA
+  int8_t channel = digitalPinToAnalogChannel(pin);
+  if (channel < 0 || channel > 9) { // DMA mode is used on ADC1 only
+    return;
+  }
+  adcChannel = channel;
+
+  adc_digi_init_config_t initConfig = {};
+  initConfig.max_store_buf_size = ADC_FRAME_BYTES * 4;
+  initConfig.conv_num_each_intr = ADC_FRAME_BYTES;
+  initConfig.adc1_chan_mask = 1 << adcChannel;
+  initConfig.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&initConfig) != ESP_OK)
+    return;
+
+  adc_digi_pattern_config_t pattern[1] = {};
+  pattern[0].atten = ADC_ATTEN_DB_11;
+  pattern[0].channel = adcChannel;
+  pattern[0].unit = 0; // ADC1
+  pattern[0].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t digiConfig = {};
+  digiConfig.conv_limit_en = false;
+  digiConfig.conv_limit_num = 250;
+  digiConfig.pattern_num = 1;
+  digiConfig.adc_pattern = pattern;
+  digiConfig.sample_freq_hz = THROTTLE_ADC_SAMPLE_HZ;
+  digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_digi_controller_configure(&digiConfig) != ESP_OK)
+    return;
+
+  #if THROTTLE_ADC_CALIBRATE
+  if (esp_adc_cal_check_efuse(ESP_ADC_CAL_VAL_EFUSE_TP_FIT) == ESP_OK) {
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcChars);
+    adcCalibrated = true;
+  }
+  #endif
+
+  adc_digi_start();
+  dmaRunning = true;
+  xTaskCreatePinnedToCore(adcTask, "throttleAdc", 3072, NULL, configMAX_PRIORITIES - 2, NULL, 0);
+
+  // wait for the first decimated value, the throttle is read right after begin
+  uint32_t start = millis();
+  while (lastSeq == 0 && millis() - start < 50) {
+    delay(1);
+  }
+#endif
+}
+
+uint16_t throttleAdcRead() {
+  if (!dmaRunning) {
+    return analogRead(adcPin);
+  }
+  return lastValue;
+}
+
+bool throttleAdcAvailable(uint16_t *value, uint32_t *timeUs) {
+  if (!dmaRunning) {
+    *value = analogRead(adcPin);
+    *timeUs = micros();
+    return true;
+  }
+  portENTER_CRITICAL(&adcMux);
+  bool fresh = lastSeq != readSeq;
+  *value = lastValue;
+  *timeUs = lastTime;
+  readSeq = lastSeq;
+  portEXIT_CRITICAL(&adcMux);
+  return fresh;
+}
@@ -0,0 +1,33 @@
+#ifndef _THROTTLEADC_H
+#define _THROTTLEADC_H
+
+#include <Arduino.h>
+
+/*
+The throttle pin is sampled continuously by the ADC in DMA mode. A task decimates the
+samples (oversample, reject outliers, average) and publishes one clean value per control period.
+*/
+
+#ifndef THROTTLE_ADC_DMA
+  #define THROTTLE_ADC_DMA 1 // 0 = fall back to analogRead() on every call
+#endif
+#ifndef THROTTLE_ADC_SAMPLE_HZ
+  #define THROTTLE_ADC_SAMPLE_HZ 20000 // ADC conversion rate
+#endif
+#ifndef THROTTLE_ADC_OUTPUT_HZ
+  #define THROTTLE_ADC_OUTPUT_HZ 100 // decimated values per second (control rate)
+#endif
+#ifndef THROTTLE_ADC_CALIBRATE
+  #define THROTTLE_ADC_CALIBRATE 0 // 1 = linearise with the eFuse curve fitting data
+#endif
+
+// Start continuous sampling of an ADC1 pin
+void throttleAdcBegin(uint8_t pin);
+
+// Latest decimated value (0-4095)
+uint16_t throttleAdcRead();
+
+// True once per new decimated value, returns the value and the micros() it was completed
+bool throttleAdcAvailable(uint16_t *value, uint32_t *timeUs);
+
+#endif
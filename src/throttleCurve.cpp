@@ -0,0 +1,56 @@
+#include "throttleCurve.h"
+
+// x and result 0.0 - 1.0
+static float shapeCurve(uint8_t shape, uint8_t expo, float x) {
+  float e = expo * 0.01f;
+  switch (shape) {
+  case CURVE_EXPO:
+    return (1 - e) * x + e * x * x * x;
+  case CURVE_S:
+    return (1 - e) * x + e * x * x * (3 - 2 * x);
+  default:
+    return x;
+  }
+}
+
+void ThrottleCurve::build(const ThrottleCurveCfg &cfg, unsigned int thMin, unsigned int thZero, unsigned int thMax) {
+  // +100 / -100 to avoid running out of range
+  float accelEnd = thMax + 100;
+  float brakeEnd = (thMin > 100) ? thMin - 100.0f : 0.0f;
+  float accelStart = thZero + cfg.deadband;
+  float brakeStart = (thZero > cfg.deadband) ? (float)(thZero - cfg.deadband) : 0.0f;
+  float maxOut = cfg.maxOut;
+
+  for (unsigned int raw = 0; raw < sizeof(lut); raw++) {
+    float out = 127;
+    if (raw > accelStart && accelEnd > accelStart) {
+      float x = min(1.0f, (raw - accelStart) / (accelEnd - accelStart));
+      out = 127 + shapeCurve(cfg.shape, cfg.expo, x) * maxOut;
+    }
+    else if (raw < brakeStart && brakeStart > brakeEnd) {
+      float x = min(1.0f, (brakeStart - raw) / (brakeStart - brakeEnd));
+      out = 127 - shapeCurve(cfg.brakeShape, cfg.brakeExpo, x) * 127;
+    }
+    lut[raw] = constrain((int)(out + 0.5f), 0, 255);
+  }
+
+  _accelRate = cfg.accelRate; // the limiter output is kept, rebuilding while riding must not cut the throttle
+}
+
+uint8_t ThrottleCurve::limit(uint8_t target, uint32_t timeUs) {
+  uint32_t dtUs = timeUs - _lastUs;
+  _lastUs = timeUs;
+
+  // braking and releasing the throttle are never delayed
+  if (_accelRate == 0 || target <= 127 || ((int32_t)target << 16) <= _out) {
+    _out = (int32_t)target << 16;
+    return target;
+  }
+
+  if (dtUs > 100000)
+    dtUs = 100000;
+  int32_t step = ((uint64_t)_accelRate << 16) * dtUs / 1000000;
+  int32_t start = max(_out, (int32_t)127 << 16);
+  _out = min(start + step, (int32_t)target << 16);
+  return _out >> 16;
+}
@@ -0,0 +1,67 @@
+#ifndef _THROTTLECURVE_H
+#define _THROTTLECURVE_H
+
+#include <Arduino.h>
+
+/*
+Maps the raw throttle value to the nunchuck value (0-255, 127 = neutral) through a lookup table.
+The table is built once at unlock, the hot path is a single indexed load.
+*/
+
+enum CurveShape {
+  CURVE_LINEAR = 0,
+  CURVE_EXPO,   // soft around neutral, steep at the end
+  CURVE_S       // soft at both ends
+};
+
+struct ThrottleCurveCfg {
+  uint8_t shape;        // CurveShape of the acceleration side
+  uint8_t expo;         // curve strength 0-100 %
+  uint8_t maxOut;       // rise of the acceleration side above 127, 128 = full throttle (255)
+  uint8_t brakeShape;   // CurveShape of the brake side
+  uint8_t brakeExpo;    // curve strength 0-100 %
+  uint16_t deadband;    // ADC steps around the neutral mapped to 127
+  uint16_t accelRate;   // max rise of the acceleration output per second (0-128 scale), 0 = unlimited
+};
+
+class ThrottleCurve {
+public:
+  /**
+   * @brief      Build the lookup table for the calibrated throttle range
+   * @param      cfg     - Curve of the riding mode
+   * @param      thMin   - Calibrated full brake value
+   * @param      thZero  - Calibrated neutral value
+   * @param      thMax   - Calibrated full throttle value
+   */
+  void build(const ThrottleCurveCfg &cfg, unsigned int thMin, unsigned int thZero, unsigned int thMax);
+
+  /**
+   * @brief      Nunchuck value for a raw throttle value
+   */
+  uint8_t map(unsigned int raw) {
+    return lut[raw < sizeof(lut) ? raw : sizeof(lut) - 1];
+  }
+
+  /**
+   * @brief      Limit the rise of the acceleration output, call once per control period
+   * @param      target  - Nunchuck value from map()
+   * @param      timeUs  - micros() of the control period
+   * @return     Nunchuck value to send
+   */
+  uint8_t limit(uint8_t target, uint32_t timeUs);
+
+  /**
+   * @brief      Start the rate limiter at neutral, at unlock and mode change; a rebuild keeps its state
+   */
+  void reset() {
+    _out = 127 << 16;
+  }
+
+private:
+  uint8_t lut[4096];
+  uint16_t _accelRate = 0;
+  int32_t _out = 127 << 16; // Q16
+  uint32_t _lastUs = 0;
+};
+
+#endif
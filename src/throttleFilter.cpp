@@ -0,0 +1,104 @@
+#include "throttleFilter.h"
+
+#define Q16 65536
+#define MAX_DT_US 100000 // a longer gap is treated as 100 ms
+
+ThrottleFilter::ThrottleFilter(ThrottleFilterType type, uint16_t tauMs) {
+  _type = type;
+  _tauUs = (tauMs > 0 ? tauMs : 1) * 1000UL;
+}
+
+void ThrottleFilter::setNoise(uint16_t noise) {
+  _r = ((int64_t)noise * noise) << 8;
+  if (_r == 0)
+    _r = 1;
+}
+
+void ThrottleFilter::setSpeedResponse(uint16_t speedRef, uint16_t dTauMs) {
+  _speedRef = speedRef > 0 ? speedRef : 1;
+  _dTauUs = (dTauMs > 0 ? dTauMs : 1) * 1000UL;
+}
+
+void ThrottleFilter::reset(uint16_t value, uint32_t timeUs) {
+  _x = (int32_t)value << 16;
+  _u = 0;
+  _p = _r;
+  _avgDtUs = 0;
+  _lastUs = timeUs;
+  _init = true;
+}
+
+uint16_t ThrottleFilter::value(void) {
+  int32_t v = (_x + Q16 / 2) >> 16;
+  return v < 0 ? 0 : (v > 0xFFFF ? 0xFFFF : v);
+}
+
+// smoothing factor of a first order low pass for this interval, Q16
+int32_t ThrottleFilter::alpha(uint32_t dtUs, uint32_t tauUs) {
+  return ((uint64_t)dtUs << 16) / (dtUs + tauUs);
+}
+
+uint16_t ThrottleFilter::update(uint16_t sample, uint32_t timeUs) {
+  if (!_init) {
+    reset(sample, timeUs);
+    return sample;
+  }
+
+  uint32_t dtUs = timeUs - _lastUs;
+  _lastUs = timeUs;
+  if (dtUs == 0)
+    dtUs = 1;
+  if (dtUs > MAX_DT_US)
+    dtUs = MAX_DT_US;
+
+  int32_t z = (int32_t)sample << 16;
+  switch (_type) {
+  case TH_FILTER_KALMAN:
+    updateKalman(z, dtUs);
+    break;
+  case TH_FILTER_CRITICAL:
+    updateCritical(z, dtUs);
+    break;
+  case TH_FILTER_ONE_EURO:
+    updateOneEuro(z, dtUs);
+    break;
+  }
+  return value();
+}
+
+void ThrottleFilter::updateKalman(int32_t z, uint32_t dtUs) {
+  // Process noise scaled so the steady state gain is about dt / tau for any sample rate
+  if (_avgDtUs == 0)
+    _avgDtUs = dtUs;
+  else
+    _avgDtUs += ((int32_t)dtUs - (int32_t)_avgDtUs) / 8;
+  _p += _r * _avgDtUs * dtUs / ((int64_t)_tauUs * _tauUs);
+
+  int64_t k = (_p << 16) / (_p + _r); // Q16
+  _x += (int32_t)((k * (int64_t)(z - _x)) >> 16);
+  _p = ((Q16 - k) * _p) >> 16;
+}
+
+void ThrottleFilter::updateCritical(int32_t z, uint32_t dtUs) {
+  // x'' = (z - x) / tau^2 - 2 x' / tau, with u = tau * x'
+  // semi-implicit Euler, sub-stepped to keep dt / tau small
+  uint32_t steps = dtUs * 4 / _tauUs + 1;
+  int32_t a = ((uint64_t)(dtUs / steps) << 16) / _tauUs; // dt / tau, Q16
+  for (uint32_t i = 0; i < steps; i++) {
+    _u += (int32_t)(((int64_t)a * ((int64_t)(z - _x) - 2 * (int64_t)_u)) >> 16);
+    _x += (int32_t)(((int64_t)a * _u) >> 16);
+  }
+}
+
+void ThrottleFilter::updateOneEuro(int32_t z, uint32_t dtUs) {
+  // speed of the raw signal in codes/s, smoothed
+  int64_t rawSpeed = ((int64_t)(z - _x) * 1000000 / dtUs) >> 16;
+  int32_t ad = alpha(dtUs, _dTauUs);
+  _u += (int32_t)((ad * (rawSpeed - _u)) >> 16);
+
+  // cutoff rises with speed: tau = tauMin / (1 + |speed| / speedRef)
+  uint32_t speed = abs(_u);
+  uint32_t tauUs = (uint64_t)_tauUs * _speedRef / (_speedRef + speed);
+  int32_t a = alpha(dtUs, tauUs);
+  _x += (int32_t)(((int64_t)a * (z - _x)) >> 16);
+}
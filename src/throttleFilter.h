@@ -0,0 +1,72 @@
+#ifndef _THROTTLEFILTER_H
+#define _THROTTLEFILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+Throttle filter working on timestamped samples in fixed point (Q16 ADC codes).
+Tuning is a time constant in ms, so the smoothing does not change with the sample rate.
+The first sample initialises the state, there is no start-up transient.
+*/
+
+enum ThrottleFilterType {
+  TH_FILTER_KALMAN = 0, // 1-D Kalman, random walk model
+  TH_FILTER_CRITICAL,   // critically damped 2nd order low pass
+  TH_FILTER_ONE_EURO    // One-Euro: low lag on fast moves, heavy smoothing at rest
+};
+
+class ThrottleFilter {
+public:
+  /**
+   * @brief      Class constructor
+   * @param      type   - Filter algorithm
+   * @param      tauMs  - Time constant in ms (at rest for One-Euro)
+   */
+  ThrottleFilter(ThrottleFilterType type, uint16_t tauMs);
+
+  /**
+   * @brief      Kalman: measurement noise of the ADC value in codes (standard deviation)
+   */
+  void setNoise(uint16_t noise);
+
+  /**
+   * @brief      One-Euro: speed in codes/s at which the cutoff frequency doubles, time constant of the speed estimate
+   */
+  void setSpeedResponse(uint16_t speedRef, uint16_t dTauMs);
+
+  /**
+   * @brief      Filter a sample
+   * @param      sample  - ADC value
+   * @param      timeUs  - micros() the sample was taken
+   * @return     Filtered value
+   */
+  uint16_t update(uint16_t sample, uint32_t timeUs);
+
+  /**
+   * @brief      Restart the filter at a value
+   */
+  void reset(uint16_t value, uint32_t timeUs);
+
+  uint16_t value(void);
+
+private:
+  ThrottleFilterType _type;
+  uint32_t _tauUs;
+  bool _init = false;
+  uint32_t _lastUs = 0;
+  int32_t _x = 0;        // estimate, Q16 codes
+  int32_t _u = 0;        // critical: rate * tau, Q16 codes; One-Euro: filtered speed in codes/s
+  int64_t _p = 0;        // Kalman: estimate variance, Q8 codes^2
+  int64_t _r = 16 << 8;  // Kalman: measurement variance, Q8 codes^2
+  uint32_t _avgDtUs = 0; // Kalman: mean sample interval
+  uint32_t _speedRef = 2000;
+  uint32_t _dTauUs = 20000;
+
+  int32_t alpha(uint32_t dtUs, uint32_t tauUs);
+  void updateKalman(int32_t z, uint32_t dtUs);
+  void updateCritical(int32_t z, uint32_t dtUs);
+  void updateOneEuro(int32_t z, uint32_t dtUs);
+};
+
+#endif
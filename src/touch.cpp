@@ -0,0 +1,165 @@
+#include "touch.h"
+#include "Wire.h"
+
+#define CST816S_ADDRESS 0x15
+
+CST816S touch(TOUCH_SDA, TOUCH_SCL, TOUCH_RST, TOUCH_IRQ); // sda, scl, rst, irq
+
+static volatile bool irqPending = false;
+static volatile uint32_t irqTime = 0;
+static TaskHandle_t waitingTask = NULL;
+
+static TouchEvent queue[TOUCH_QUEUE_LEN];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+
+static bool down = false;        // finger on the screen (debounced)
+static bool liftPending = false; // controller reported a lift, waiting for debounce
+static uint32_t liftTime = 0;
+static uint32_t lastIrqTime = 0;
+static uint32_t downTime = 0;
+static bool longPressSent = false;
+static int16_t downX, downY, lastX, lastY;
+
+static void IRAM_ATTR touchIsr() {
+  irqTime = millis();
+  irqPending = true;
+  if (waitingTask != NULL) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(waitingTask, &woken);
+    if (woken)
+      portYIELD_FROM_ISR();
+  }
+}
+
+static void pushEvent(TouchEventType type, int16_t x, int16_t y, uint32_t time) {
+  if (queueCount == TOUCH_QUEUE_LEN) { // drop the oldest
+    queueHead = (queueHead + 1) % TOUCH_QUEUE_LEN;
+    queueCount--;
+  }
+  TouchEvent &ev = queue[(queueHead + queueCount) % TOUCH_QUEUE_LEN];
+  ev.type = type;
+  ev.x = x;
+  ev.y = y;
+  ev.time = time;
+  queueCount++;
+}
+
+// same register block the CST816S lib reads: gesture, points, event|xH, xL, yH, yL
+static bool readController(uint8_t *points, uint8_t *event, int16_t *x, int16_t *y) {
+  uint8_t buf[6];
+  Wire.beginTransmission(CST816S_ADDRESS);
+  Wire.write(0x01);
+  if (Wire.endTransmission(false) != 0)
+    return false;
+  if (Wire.requestFrom((uint8_t)CST816S_ADDRESS, (uint8_t)6) != 6)
+    return false;
+  for (int i = 0; i < 6; i++) {
+    buf[i] = Wire.read();
+  }
+  *points = buf[1];
+  *event = buf[2] >> 6; // 0 = down, 1 = lift, 2 = contact
+  *x = ((buf[2] & 0x0F) << 8) | buf[3];
+  *y = ((buf[4] & 0x0F) << 8) | buf[5];
+
+  touch.data.gestureID = buf[0];
+  touch.data.points = *points;
+  touch.data.event = *event;
+  touch.data.x = *x;
+  touch.data.y = *y;
+  return true;
+}
+
+void initTouch() {
+  touch.begin(FALLING);
+  // replace the lib's handler, reading is done outside the ISR in serviceTouch()
+  attachInterrupt(TOUCH_IRQ, touchIsr, FALLING);
+}
+
+void serviceTouch() {
+  uint32_t now = millis();
+
+  if (irqPending) {
+    irqPending = false;
+    uint32_t t = irqTime;
+    uint8_t points, event;
+    int16_t x, y;
+
+    if (readController(&points, &event, &x, &y)) {
+      lastIrqTime = t;
+      if (event == 1 || points == 0) {
+        if (down && !liftPending) {
+          liftPending = true;
+          liftTime = t;
+        }
+      }
+      else if (!down) {
+        down = true;
+        downTime = t;
+        longPressSent = false;
+        downX = lastX = x;
+        downY = lastY = y;
+        pushEvent(TOUCH_DOWN, x, y, t);
+      }
+      else {
+        liftPending = false; // contact came back within debounce time
+        if (x != lastX || y != lastY) {
+          lastX = x;
+          lastY = y;
+          pushEvent(TOUCH_MOVE, x, y, t);
+        }
+      }
+    }
+  }
+
+  if (!down)
+    return;
+
+  // lift without a lift report from the controller
+  if (!liftPending && now - lastIrqTime > TOUCH_RELEASE_MS) {
+    liftPending = true;
+    liftTime = lastIrqTime;
+  }
+
+  if (liftPending && now - liftTime >= TOUCH_DEBOUNCE_MS) {
+    down = false;
+    liftPending = false;
+    pushEvent(TOUCH_UP, lastX, lastY, liftTime);
+    return;
+  }
+
+  if (!longPressSent && !liftPending && now - downTime >= TOUCH_LONG_PRESS_MS &&
+      abs(lastX - downX) < TOUCH_LONG_PRESS_SLOP && abs(lastY - downY) < TOUCH_LONG_PRESS_SLOP) {
+    longPressSent = true;
+    pushEvent(TOUCH_LONG_PRESS, downX, downY, downTime + TOUCH_LONG_PRESS_MS);
+  }
+}
+
+bool nextTouchEvent(TouchEvent *ev) {
+  if (queueCount == 0)
+    return false;
+  *ev = queue[queueHead];
+  queueHead = (queueHead + 1) % TOUCH_QUEUE_LEN;
+  queueCount--;
+  return true;
+}
+
+bool touchIsDown() {
+  return down;
+}
+
+bool waitTouch(uint32_t maxWaitMs) {
+  // wake up in time for the release / long press timers
+  if (down)
+    maxWaitMs = min(maxWaitMs, (uint32_t)TOUCH_DEBOUNCE_MS);
+  waitingTask = xTaskGetCurrentTaskHandle();
+  if (!irqPending && queueCount == 0)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxWaitMs));
+  waitingTask = NULL;
+  return irqPending || queueCount > 0;
+}
+
+void touchWakeup() {
+  irqTime = millis();
+  irqPending = true;
+}
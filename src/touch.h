@@ -0,0 +1,58 @@
+#ifndef _TOUCH_H
+#define _TOUCH_H
+
+#include <Arduino.h>
+#include <CST816S.h> //TouchLib
+
+#define TOUCH_SDA 18
+#define TOUCH_SCL 17
+#define TOUCH_RST 21
+#define TOUCH_IRQ 16
+
+#ifndef TOUCH_DEBOUNCE_MS
+  #define TOUCH_DEBOUNCE_MS 50 // a lift shorter than this is treated as bouncing contact
+#endif
+#ifndef TOUCH_RELEASE_MS
+  #define TOUCH_RELEASE_MS 100 // no interrupt for this long while touched = finger lifted
+#endif
+#ifndef TOUCH_LONG_PRESS_MS
+  #define TOUCH_LONG_PRESS_MS 1000
+#endif
+#define TOUCH_LONG_PRESS_SLOP 20 // max movement in px for a long press
+#define TOUCH_QUEUE_LEN 16
+
+enum TouchEventType {
+  TOUCH_DOWN = 0,
+  TOUCH_MOVE,
+  TOUCH_UP,
+  TOUCH_LONG_PRESS
+};
+
+struct TouchEvent {
+  TouchEventType type;
+  int16_t x;
+  int16_t y;
+  uint32_t time; // millis() of the controller interrupt
+};
+
+extern CST816S touch;
+
+// Reset the controller and attach the interrupt
+void initTouch();
+
+// Read the controller if it raised its interrupt and queue the resulting events
+void serviceTouch();
+
+// Pop the oldest queued event, false if the queue is empty
+bool nextTouchEvent(TouchEvent *ev);
+
+// Finger is currently on the screen
+bool touchIsDown();
+
+// Sleep until the next touch interrupt or a pending touch timer, at most maxWaitMs, true if touched
+bool waitTouch(uint32_t maxWaitMs);
+
+// The interrupt pin ended a light sleep, the edge interrupt was lost there
+void touchWakeup();
+
+#endif
@@ -0,0 +1,231 @@
+#include "ui.h"
+#include "configStore.h"
+#include "display.h"
+#include "params.h"
+#include "touch.h"
+
+// Globals from main.cpp (Externs)
+extern bool lock;
+extern bool modeS;
+extern bool lightF;
+extern unsigned int throttleRAW;
+extern unsigned int maxVal;
+extern unsigned int minVal;
+extern float speed;
+
+UiState uiState = UI_LOCKED;
+
+static int code1, code2, codeCal;
+static uint32_t pinResetAt = 0;     // wrong PIN is shown until then, 0 = none
+static uint32_t restartAt = 0;      // calibration finished, restart at this time, 0 = none
+static uint32_t lastCalDraw = 0;
+static uint32_t lastChange = 0;     // last touch or changed dashboard frame
+static uint8_t page = 0;            // dashboard page, see pageCount()
+static bool settings = false;       // settings shown instead of the page
+static int16_t downX, downY;        // start of the current touch, for swipes and taps
+static bool longPress;              // the current touch was held for a long press
+static uint8_t settingIndex = 0;    // parameter shown on the settings page
+static const uint32_t pinResetDelay = 300;
+static const uint32_t calDrawInterval = 50;
+
+void uiBegin(int mode1, int mode2, int throttleCal) {
+  code1 = mode1;
+  code2 = mode2;
+  codeCal = throttleCal;
+  uiState = UI_LOCKED;
+  lockscreen(-1, -1, code1, code2, codeCal);
+}
+
+static void saveLockMode() {
+  configEdit().lockMode = lockMode;
+}
+
+static void tickLocked(uint32_t now) {
+  TouchEvent ev;
+
+  // wrong 4-digit PIN was visible long enough
+  if (pinResetAt != 0 && (int32_t)(now - pinResetAt) >= 0) {
+    pinResetAt = 0;
+    entry = "";
+    lockscreen(-1, -1, code1, code2, codeCal);
+  }
+
+  while (nextTouchEvent(&ev)) {
+    lastChange = now;
+    // Toggle lock mode (Long Press on "Locked" text)
+    // Area: Centered 85, 25. Width 100, Height 50. => X: 35-135, Y: 0-50
+    if (ev.type == TOUCH_LONG_PRESS) {
+      if (ev.x > 35 && ev.x < 135 && ev.y > 0 && ev.y < 50) {
+        lockMode = (lockMode == PATTERN) ? PIN : PATTERN;
+        entry = "";
+        pinResetAt = 0;
+        lockscreen(-1, -1, code1, code2, codeCal);
+        saveLockMode();
+      }
+      continue;
+    }
+
+    if (lockMode == PATTERN) {
+      // Pattern Mode: Continuous Drag, a new stroke starts a new entry
+      if (ev.type == TOUCH_DOWN) {
+        entry = "";
+      }
+      if (ev.type == TOUCH_UP) {
+        // Reset on Release if incorrect
+        if (entry.length() > 0) {
+          entry = "";
+          lockscreen(-1, -1, code1, code2, codeCal); // Clear visuals
+        }
+      }
+      else {
+        lockscreen(ev.x, ev.y, code1, code2, codeCal);
+      }
+    }
+    else {
+      // PIN Mode: Single Press per touch, release clears the highlight
+      if (ev.type == TOUCH_DOWN && pinResetAt == 0) {
+        lockscreen(ev.x, ev.y, code1, code2, codeCal);
+        // Auto-reset if 4 digits and incorrect
+        if (entry.length() >= 4 && lock == 1 && confMode == 0) {
+          pinResetAt = now + pinResetDelay;
+        }
+      }
+      else if (ev.type == TOUCH_UP) {
+        lockscreen(-1, -1, code1, code2, codeCal);
+      }
+    }
+
+    if (confMode == 1) {
+      uiState = UI_CALIBRATION;
+      lastCalDraw = now - calDrawInterval;
+      maxVal = throttleRAW;
+      minVal = throttleRAW;
+      return;
+    }
+    if (lock == 0) {
+      uiState = UI_DASHBOARD;
+      return;
+    }
+  }
+}
+
+static void tickCalibration(uint32_t now) {
+  TouchEvent ev;
+
+  if (restartAt != 0) {
+    // the calibration is written by the config job first
+    if ((int32_t)(now - restartAt) >= 0 && !configPending())
+      ESP.restart();
+    return;
+  }
+
+  if (throttleRAW > maxVal) {
+    maxVal = throttleRAW;
+  }
+  if (throttleRAW < minVal) {
+    minVal = throttleRAW;
+  }
+
+  while (nextTouchEvent(&ev)) {
+    if (ev.type != TOUCH_DOWN)
+      continue;
+    if (ev.y > 245 && ev.y < 295 && ev.x > 85) {
+      ConfigData &cfg = configEdit();
+      cfg.thMax = maxVal;       // at 5V input, the Hall Sensor Value should be 4095 on full throttle
+      cfg.thZero = throttleRAW; // schould be about 2880, depends on input Voltage ~ 5V
+      cfg.thMin = minVal;       // schould be about 2100, depends on input Voltage ~ 5V
+      mainSprite.fillSprite(TFT_BLACK);
+      mainSprite.pushSprite(0, 0);
+      restartAt = now + 100;
+      return;
+    }
+    if (ev.y > 245 && ev.y < 295 && ev.x < 85) {
+      mainSprite.fillSprite(TFT_BLACK);
+      mainSprite.pushSprite(0, 0);
+      ESP.restart();
+    }
+  }
+
+  if (now - lastCalDraw >= calDrawInterval) {
+    lastCalDraw = now;
+    drawCalibration();
+  }
+}
+
+static void touchSettings(const TouchEvent &ev) {
+  uint8_t count = paramCount();
+  if (ev.type != TOUCH_DOWN || count == 0)
+    return;
+  // previous / next parameter
+  if (ev.y > 60 && ev.y < 110) {
+    if (ev.x < 60)
+      settingIndex = (settingIndex + count - 1) % count;
+    else if (ev.x > 110)
+      settingIndex = (settingIndex + 1) % count;
+  }
+  // decrease / increase at standstill, values outside the range are refused
+  else if (ev.y > 245 && ev.y < 295 && uiEditAllowed()) {
+    float step = paramDef(settingIndex).step;
+    paramSet(settingIndex, paramGet(settingIndex) + (ev.x < 85 ? -step : step));
+  }
+}
+
+static void tickDashboard(uint32_t now) {
+  TouchEvent ev;
+
+  while (nextTouchEvent(&ev)) {
+    lastChange = now;
+    if (ev.type == TOUCH_DOWN) {
+      downX = ev.x;
+      downY = ev.y;
+      longPress = false;
+    }
+    else if (ev.type == TOUCH_LONG_PRESS)
+      longPress = true; // the release is no tap
+    // long press above the buttons opens and closes the settings
+    if (ev.type == TOUCH_LONG_PRESS && ev.y < 212)
+      settings = !settings;
+    else if (settings)
+      touchSettings(ev);
+    else if (ev.type == TOUCH_UP) {
+      int dx = ev.x - downX;
+      int dy = ev.y - downY;
+      // horizontal swipe: left shows the next page, right the previous one
+      if (abs(dx) >= UI_SWIPE_MIN_PX && abs(dx) > abs(dy))
+        page = (page + (dx < 0 ? 1 : pageCount() - 1)) % pageCount();
+      // tap on the light button of the main page switches the headlight
+      else if (page == 0 && downY >= 212 && !longPress && abs(dx) < TOUCH_LONG_PRESS_SLOP && abs(dy) < TOUCH_LONG_PRESS_SLOP)
+        lightF = !lightF;
+    }
+  }
+  if (settings && paramCount() > 0 ? drawSettings(settingIndex) : drawPage(page))
+    lastChange = now;
+}
+
+uint32_t uiTelemetry() {
+  return uiState == UI_DASHBOARD && !settings ? pageTelemetry(page) : 0;
+}
+
+bool uiEditAllowed() {
+  return uiState == UI_DASHBOARD && fabsf(speed) < 1;
+}
+
+bool uiActive(uint32_t now) {
+  return uiState == UI_CALIBRATION || touchIsDown() || fabsf(speed) >= 1 || now - lastChange < UI_ACTIVE_MS;
+}
+
+void uiTick(uint32_t now) {
+  serviceTouch();
+
+  switch (uiState) {
+  case UI_LOCKED:
+    tickLocked(now);
+    break;
+  case UI_CALIBRATION:
+    tickCalibration(now);
+    break;
+  case UI_DASHBOARD:
+    tickDashboard(now);
+    break;
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef _UI_H
+#define _UI_H
+
+#include <Arduino.h>
+
+#define UI_ACTIVE_MS 2000 // full frame rate for this long after the last change or touch
+#define UI_SWIPE_MIN_PX 50 // horizontal travel of a page swipe
+
+enum UiState {
+  UI_LOCKED = 0,
+  UI_CALIBRATION,
+  UI_DASHBOARD
+};
+
+extern UiState uiState;
+
+// Store the unlock codes and show the lockscreen
+void uiBegin(int mode1, int mode2, int throttleCal);
+
+// Handle touch input and screen updates of the current state, never blocks
+void uiTick(uint32_t now);
+
+// True while the screen needs the full frame rate: moving, touched, calibrating or recently changed
+bool uiActive(uint32_t now);
+
+// Unlocked and standing still: the only state in which parameters may change
+bool uiEditAllowed();
+
+// Telemetry fields the visible dashboard page needs beyond the always polled ones, 0 if none
+uint32_t uiTelemetry();
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _UNITS_H
+#define _UNITS_H
+
+#include <Arduino.h>
+
+/*
+Unit system of the display, selected at compile time with USE_IMPERIAL_UNITS.
+Conversion<U> folds wheel, motor and unit factors into one fixed point multiplier per quantity,
+computed once when the setup changes. Speed and motor rpm are scaled from the integer eRPM,
+distance from the integer tachometer count; the 64 bit product is exact and rounded only once,
+so the trip does not lose precision on long rides.
+Values that are kept metric (ride statistics, range) are converted with fromKm<U>().
+*/
+
+#ifndef USE_IMPERIAL_UNITS
+#define USE_IMPERIAL_UNITS 0
+#endif
+
+struct MetricUnits {
+  static constexpr float perKm() { return 1.0f; }
+  static const char *distance() { return "km"; }
+  static const char *speed() { return "km/h"; }
+};
+
+struct ImperialUnits {
+  static constexpr float perKm() { return 0.621371f; }
+  static const char *distance() { return "mi"; }
+  static const char *speed() { return "mph"; }
+};
+
+#if USE_IMPERIAL_UNITS == 1
+typedef ImperialUnits DisplayUnits;
+#else
+typedef MetricUnits DisplayUnits;
+#endif
+
+// km or km/h in the units U
+template <class U> constexpr float fromKm(float km) {
+  return km * U::perKm();
+}
+
+template <class U> class Conversion {
+public:
+  /**
+   * @brief      Precompute the multipliers
+   * @param      kmhPerErpm  - Speed of one eRPM
+   * @param      kmPerStep   - Distance of one tachometer step
+   * @param      erpmPerRpm  - Motor pole pairs (times gear ratio for the wheel rpm)
+   */
+  void setScale(float kmhPerErpm, float kmPerStep, float erpmPerRpm) {
+    speedQ32 = toFixed(fromKm<U>(kmhPerErpm), 32);
+    rpmQ32 = erpmPerRpm > 0 ? toFixed(1.0 / erpmPerRpm, 32) : 0;
+    distQ40 = toFixed(fromKm<U>(kmPerStep), 40);
+  }
+
+  // distance units per hour
+  float speed(int32_t erpm) const {
+    return fromFixed((int64_t)erpm * speedQ32, 32);
+  }
+
+  float rpm(int32_t erpm) const {
+    return fromFixed((int64_t)erpm * rpmQ32, 32);
+  }
+
+  // distance units
+  float distance(int32_t steps) const {
+    return fromFixed((int64_t)steps * distQ40, 40);
+  }
+
+private:
+  // exact integer product, rounded once when converted to float
+  static int64_t toFixed(double v, int bits) {
+    return (int64_t)(v * (double)(1ULL << bits) + 0.5);
+  }
+  static float fromFixed(int64_t v, int bits) {
+    return (float)((double)v / (double)(1ULL << bits));
+  }
+
+  int64_t speedQ32 = 0; // units/h per eRPM
+  int64_t rpmQ32 = 0;
+  int64_t distQ40 = 0;  // units per tachometer step, 2^31 steps of up to 1 m still fit the product
+};
+
+#endif
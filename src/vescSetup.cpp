@@ -0,0 +1,149 @@
+#include "vescSetup.h"
+#include "crc.h"
+#include <Preferences.h>
+
+#define SETUP_RPM (1UL << 5)
+#define SETUP_SPEED (1UL << 6)
+
+struct SetupCache {
+  uint8_t fwMajor;
+  uint8_t fwMinor;
+  uint16_t crc; // of the firmware version and the factor
+  float speedFactor;
+};
+
+enum SetupState {
+  STATE_FW = 0, // waiting for the firmware version
+  STATE_VERIFY, // cached factor, check it with one reply
+  STATE_MEASURE,
+  STATE_DONE
+};
+
+static VescComms *vesc = NULL;
+static void (*changed)() = NULL;
+static SetupCache cache;
+static bool cacheLoaded = false;
+static bool valid = false;
+static SetupState state = STATE_FW;
+static uint8_t fwTries = 0;
+static uint32_t lastRequestMs = 0;
+static uint32_t seenCount = 0;
+static float sum = 0;
+static uint8_t samples = 0;
+
+static uint16_t cacheCrc(const SetupCache &c) {
+  uint8_t buf[6];
+  buf[0] = c.fwMajor;
+  buf[1] = c.fwMinor;
+  memcpy(&buf[2], &c.speedFactor, sizeof(float));
+  return crc16(buf, sizeof(buf));
+}
+
+static void store(float speedFactor) {
+  cache.fwMajor = vesc->fw_version.major;
+  cache.fwMinor = vesc->fw_version.minor;
+  cache.speedFactor = speedFactor;
+  cache.crc = cacheCrc(cache);
+  cacheLoaded = true;
+
+  Preferences pref;
+  pref.begin("vescSetup", false);
+  pref.putBytes("cache", &cache, sizeof(cache));
+  pref.end();
+}
+
+void vescSetupBegin(VescComms *v, void (*onChange)()) {
+  vesc = v;
+  changed = onChange;
+
+  Preferences pref;
+  if (pref.begin("vescSetup", true)) {
+    cacheLoaded = pref.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache) && cacheCrc(cache) == cache.crc &&
+                  cache.speedFactor > 0;
+    pref.end();
+  }
+}
+
+// firmware known, decide between the cache and a new measurement
+static void checkFirmware() {
+  if (vesc->fw_version.major < VESC_SETUP_MIN_FW) {
+    state = STATE_DONE; // keep the manual setup
+    return;
+  }
+  if (cacheLoaded && cache.fwMajor == vesc->fw_version.major && cache.fwMinor == vesc->fw_version.minor) {
+    valid = true;
+    state = STATE_VERIFY;
+    if (changed)
+      changed();
+  }
+  else {
+    state = STATE_MEASURE;
+  }
+}
+
+static void sample(float factor) {
+  if (state == STATE_VERIFY) {
+    if (fabsf(factor / cache.speedFactor - 1) < VESC_SETUP_TOLERANCE) {
+      state = STATE_DONE;
+      return;
+    }
+    state = STATE_MEASURE; // setup changed in VESC Tool, the cached factor stays until the new one is known
+  }
+
+  sum += factor;
+  if (++samples < VESC_SETUP_SAMPLES)
+    return;
+  store(sum / samples);
+  sum = 0;
+  samples = 0;
+  valid = true;
+  state = STATE_DONE;
+  if (changed)
+    changed();
+}
+
+void vescSetupService(uint32_t nowMs, float erpm) {
+  if (vesc == NULL || state == STATE_DONE || nowMs - lastRequestMs < VESC_SETUP_POLL_MS)
+    return;
+
+  if (state == STATE_FW) {
+    if (vesc->fw_version.major != 0) {
+      checkFirmware();
+      return;
+    }
+    if (nowMs - lastRequestMs < VESC_SETUP_FW_RETRY_MS)
+      return;
+    if (++fwTries > VESC_SETUP_FW_TRIES) {
+      state = STATE_DONE; // no answer, keep the manual setup
+      return;
+    }
+    lastRequestMs = nowMs;
+    vesc->getFWversion();
+    return;
+  }
+
+  // a reply decoded since the last request (over CAN it arrives with a later poll)
+  if (vesc->setup.count != seenCount) {
+    seenCount = vesc->setup.count;
+    if (fabsf(vesc->setup.rpm) >= VESC_SETUP_MIN_ERPM)
+      sample(fabsf(vesc->setup.speed) * 3.6f / fabsf(vesc->setup.rpm));
+  }
+
+  if (state != STATE_DONE && fabsf(erpm) >= VESC_SETUP_MIN_ERPM) {
+    lastRequestMs = nowMs;
+    vesc->getVescValuesSetupSelective(SETUP_RPM | SETUP_SPEED);
+  }
+}
+
+bool vescSetupValid() {
+  return valid;
+}
+
+float vescSetupSpeedFactor() {
+  return cache.speedFactor;
+}
+
+float vescSetupTripFactor() {
+  // distance per tachometer step is 10 times the speed in m/s per eRPM
+  return cache.speedFactor / 3.6f * 10 / 1000;
+}
@@ -0,0 +1,47 @@
+#ifndef _VESCSETUP_H
+#define _VESCSETUP_H
+
+#include <Arduino.h>
+#include "VescComms.h"
+
+/*
+Speed and distance scaling from the motor setup of the VESC (poles, gear ratio, wheel diameter).
+The VESC reports speed computed from its own configuration, so eRPM and speed of one
+COMM_GET_VALUES_SETUP_SELECTIVE reply give the factor; the tachometer uses the same setup
+(distance per step = 10 * speed per eRPM). Replies are only usable while the wheel turns.
+The factor is cached in NVS with the firmware version and a CRC. With a matching cache it is
+used from the start and only checked once against a single reply, it is measured again when
+the firmware or the setup in VESC Tool changed.
+*/
+
+#define VESC_SETUP_MIN_FW 5        // older firmware has no setup values
+#define VESC_SETUP_FW_RETRY_MS 1000
+#define VESC_SETUP_FW_TRIES 10
+#define VESC_SETUP_POLL_MS 500     // request period while riding
+#define VESC_SETUP_MIN_ERPM 2000   // slower replies are too coarse
+#define VESC_SETUP_SAMPLES 8       // averaged for a new factor
+#define VESC_SETUP_TOLERANCE 0.02f // relative difference of a changed setup
+
+/**
+ * @brief      Load the cached factor
+ * @param      vesc      - Controller to ask
+ * @param      onChange  - Called when a new factor was measured
+ */
+void vescSetupBegin(VescComms *vesc, void (*onChange)());
+
+/**
+ * @brief      Check the firmware version and request setup values while riding, call from a low priority job
+ * @param      erpm  - Current eRPM from the telemetry
+ */
+void vescSetupService(uint32_t nowMs, float erpm);
+
+// True if the factors belong to the connected VESC (cached for its firmware or measured)
+bool vescSetupValid();
+
+// km/h per eRPM
+float vescSetupSpeedFactor();
+
+// km per tachometer step
+float vescSetupTripFactor();
+
+#endif
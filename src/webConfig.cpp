@@ -0,0 +1,59 @@
+#include "webConfig.h"
+#include "configStore.h"
+#include "params.h"
+#include "ui.h"
+#include <WebServer.h>
+
+static WebServer server(80);
+static bool started = false;
+
+// collects the output of the parameter functions for the reply
+class ReplyText : public Print {
+public:
+  String text;
+  size_t write(uint8_t c) {
+    text += (char)c;
+    return 1;
+  }
+};
+
+static void handleParams() {
+  ReplyText reply;
+  paramsPrint(reply);
+  server.send(200, "text/plain", reply.text);
+}
+
+// a remote change has to carry one of the unlock codes, a link or a page opened on the network has none
+static bool authorized() {
+  if (!server.hasArg("code"))
+    return false;
+  long code = server.arg("code").toInt();
+  return code == config().mode1 || code == config().mode2;
+}
+
+static void handleSet() {
+  if (!server.hasArg("name") || !server.hasArg("value")) {
+    server.send(400, "text/plain", "usage: POST /set name=<param>&value=<value>&code=<unlock code>\n");
+    return;
+  }
+  if (!authorized()) {
+    server.send(403, "text/plain", "unlock code required\n");
+    return;
+  }
+  ReplyText reply;
+  paramsCommand("set " + server.arg("name") + " " + server.arg("value"), reply, uiEditAllowed(), false);
+  server.send(200, "text/plain", reply.text);
+}
+
+void webConfigBegin() {
+  server.on("/", handleParams);
+  server.on("/params", handleParams);
+  server.on("/set", HTTP_POST, handleSet);
+  server.begin();
+  started = true;
+}
+
+void webConfigHandle() {
+  if (started)
+    server.handleClient();
+}
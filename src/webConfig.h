@@ -0,0 +1,19 @@
+#ifndef _WEBCONFIG_H
+#define _WEBCONFIG_H
+
+#include <Arduino.h>
+
+/*
+HTTP access to the runtime parameters on port 80 (advertised by mDNS):
+  GET  /params                                     list as text
+  POST /set     name=wheelDia&value=250&code=1234  code = one of the unlock codes
+Changes are refused while the dashboard is locked or moving, unlock codes can not be changed remotely.
+*/
+
+// Start the server, needs a WiFi connection
+void webConfigBegin();
+
+// Answer pending requests, call from a low priority job
+void webConfigHandle();
+
+#endif
@@ -0,0 +1,92 @@
+// Host tests of the state of charge table against the former CapCheckPerc(), run with: pio test -e native
+#include "LiPoCheck.h"
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+
+static const int cells = 12;
+
+void setUp() {
+  SocInit(CHEM_LIION_NMC);
+}
+
+void tearDown() {}
+
+// same curve as liionDC: the table rounds, CapCheckPerc() truncates, so they differ by at most one percent
+static void test_nmc_matches_cap_check() {
+  for (uint32_t mv = 3001; mv <= 4100; mv++) {
+    uint32_t packMv = mv * cells;
+    uint8_t cap = CapCheckPerc(packMv / 1000.0f, cells);
+    uint8_t soc = SocCheckPerc(packMv, cells);
+    TEST_ASSERT_INT_WITHIN_MESSAGE(1, cap, soc, "cell mV in the liionDC range");
+  }
+}
+
+// CapCheckPerc() gives 0 between 4.10 and 4.20 V (the search runs past the table), the table stays full
+static void test_nmc_ends() {
+  TEST_ASSERT_EQUAL_UINT8(0, SocCheckPerc(2900 * cells, cells));
+  TEST_ASSERT_EQUAL_UINT8(0, SocCheckPerc(3000 * cells, cells));
+  TEST_ASSERT_EQUAL_UINT8(100, SocCheckPerc(4150 * cells, cells));
+  TEST_ASSERT_EQUAL_UINT8(100, SocCheckPerc(4300 * cells, cells));
+  TEST_ASSERT_EQUAL_UINT8(100, CapCheckPerc(4.25f * cells, cells));
+  TEST_ASSERT_EQUAL_UINT8(0, SocCheckPerc(40000, 0));
+}
+
+// full resolution input: a 12S pack moves by one percent steps, not by whole volts
+static void test_resolution() {
+  uint8_t last = SocCheckPerc(3300 * cells, cells);
+  for (uint32_t packMv = 3300 * cells; packMv <= 4100 * cells; packMv += 50) {
+    uint8_t soc = SocCheckPerc(packMv, cells);
+    TEST_ASSERT_TRUE_MESSAGE(soc >= last && soc - last <= 1, "50 mV pack steps change at most one percent");
+    last = soc;
+  }
+}
+
+static void test_chemistries_monotonic() {
+  for (uint8_t chem = CHEM_LIION_NMC; chem <= CHEM_LIION_MOLICEL; chem++) {
+    SocInit(chem);
+    uint8_t last = 0;
+    for (uint32_t mv = SOC_MIN_MV; mv <= SOC_MAX_MV; mv++) {
+      uint8_t soc = SocCheckPerc(mv * cells, cells);
+      TEST_ASSERT_TRUE_MESSAGE(soc >= last && soc <= 100, "rising with the voltage, 0-100 %");
+      last = soc;
+    }
+    TEST_ASSERT_EQUAL_UINT8(100, last);
+  }
+}
+
+// time per call of both functions over the same voltage sweep
+static void test_benchmark() {
+  const int rounds = 200;
+  volatile uint32_t sink = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (uint32_t mv = SOC_MIN_MV; mv <= SOC_MAX_MV; mv++)
+      sink += CapCheckPerc(mv * cells / 1000.0f, cells);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (uint32_t mv = SOC_MIN_MV; mv <= SOC_MAX_MV; mv++)
+      sink += SocCheckPerc(mv * cells, cells);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  double calls = (double)rounds * (SOC_MAX_MV - SOC_MIN_MV + 1);
+  double capNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+  double socNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / calls;
+  char msg[96];
+  snprintf(msg, sizeof(msg), "CapCheckPerc %.1f ns/call, SocCheckPerc %.1f ns/call", capNs, socNs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_THAN(capNs, socNs);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_nmc_matches_cap_check);
+  RUN_TEST(test_nmc_ends);
+  RUN_TEST(test_resolution);
+  RUN_TEST(test_chemistries_monotonic);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
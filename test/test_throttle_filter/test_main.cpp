@@ -0,0 +1,174 @@
+// Host benchmark of the throttle filters: lag and noise on a throttle trace, run with: pio test -e native
+#include "throttleFilter.h"
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+/*
+The trace follows the control job: one decimated ADC value every 10 ms with +-2 ms jitter and
+the noise of thFilterNoise (standard deviation 4 codes). It steps between neutral (2880),
+full throttle (3880) and brake (2200) and holds each level for 400 ms.
+A recorded trace can be added as trace_recorded.h with
+  static const TraceSample recordedTrace[] = {{timeUs, raw}, ...};
+its lag and noise are then measured against a centred moving average and printed as well.
+*/
+
+struct TraceSample {
+  uint32_t timeUs;
+  uint16_t raw;
+  uint16_t truth; // noise free value, 0 = unknown
+};
+
+static const uint16_t tauMs = 20; // thFilterMs
+static const uint16_t noiseSd = 4;
+static const uint32_t holdUs = 400000;
+static const uint16_t levels[] = {2880, 3880, 2880, 2200, 2880};
+
+void setUp() {}
+
+void tearDown() {}
+
+// deterministic noise: sum of uniforms, close to normal
+static uint32_t rng = 12345;
+static float noise() {
+  float s = 0;
+  for (int i = 0; i < 12; i++) {
+    rng = rng * 1664525 + 1013904223;
+    s += (rng >> 8) / 16777216.0f;
+  }
+  return (s - 6) * noiseSd;
+}
+
+static std::vector<TraceSample> syntheticTrace() {
+  std::vector<TraceSample> trace;
+  uint32_t t = 0;
+  for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+    uint32_t end = (l + 1) * holdUs;
+    while (t < end) {
+      TraceSample s;
+      s.timeUs = t;
+      s.truth = levels[l];
+      s.raw = (uint16_t)lroundf(levels[l] + noise());
+      trace.push_back(s);
+      rng = rng * 1664525 + 1013904223;
+      t += 8000 + (rng >> 8) % 4001; // 10 ms +- 2 ms
+    }
+  }
+  return trace;
+}
+
+struct FilterResult {
+  float noise; // RMS error in the settled part of each hold, codes
+  float lagMs; // longest time to 90 % of a step
+};
+
+static FilterResult measure(ThrottleFilterType type, const std::vector<TraceSample> &trace) {
+  ThrottleFilter f(type, tauMs);
+  f.setNoise(noiseSd);
+  f.setSpeedResponse(2000, tauMs);
+
+  FilterResult r = {0, 0};
+  double sq = 0;
+  int n = 0;
+  uint32_t stepUs = 0;
+  uint16_t from = trace[0].truth;
+  bool settled = true;
+  for (size_t i = 0; i < trace.size(); i++) {
+    const TraceSample &s = trace[i];
+    uint16_t out = f.update(s.raw, s.timeUs);
+    if (i > 0 && s.truth != trace[i - 1].truth) {
+      from = trace[i - 1].truth;
+      stepUs = s.timeUs;
+      settled = false;
+    }
+    if (!settled && fabsf((float)out - from) >= 0.9f * fabsf((float)s.truth - from)) {
+      settled = true;
+      r.lagMs = fmaxf(r.lagMs, (s.timeUs - stepUs) / 1000.0f);
+    }
+    if (s.timeUs - stepUs > 150000 || stepUs == 0) {
+      sq += ((double)out - s.truth) * ((double)out - s.truth);
+      n++;
+    }
+  }
+  r.noise = sqrt(sq / n);
+  return r;
+}
+
+static const char *names[] = {"Kalman", "critical", "One-Euro"};
+
+static void checkFilter(ThrottleFilterType type) {
+  std::vector<TraceSample> trace = syntheticTrace();
+  FilterResult r = measure(type, trace);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%-8s noise %.2f codes (raw %u), lag to 90 %% %.0f ms", names[type], r.noise, noiseSd,
+           r.lagMs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_THAN(0.6f * noiseSd, r.noise);
+  TEST_ASSERT_TRUE_MESSAGE(r.lagMs > 0, "every step is followed");
+  TEST_ASSERT_LESS_OR_EQUAL(5.0f * tauMs, r.lagMs);
+}
+
+static void test_kalman() {
+  checkFilter(TH_FILTER_KALMAN);
+}
+
+static void test_critical() {
+  checkFilter(TH_FILTER_CRITICAL);
+}
+
+static void test_one_euro() {
+  checkFilter(TH_FILTER_ONE_EURO);
+}
+
+// the smoothing follows the time constant, not the number of samples
+static void test_sample_rate_independent() {
+  for (int type = TH_FILTER_KALMAN; type <= TH_FILTER_ONE_EURO; type++) {
+    ThrottleFilter slow((ThrottleFilterType)type, tauMs), fast((ThrottleFilterType)type, tauMs);
+    slow.update(2880, 0);
+    fast.update(2880, 0);
+    for (uint32_t t = 1000; t <= 40000; t += 1000) {
+      fast.update(3880, t);
+      if (t % 10000 == 0)
+        slow.update(3880, t);
+    }
+    TEST_ASSERT_INT_WITHIN_MESSAGE(150, fast.value(), slow.value(), names[type]);
+  }
+}
+
+#if __has_include("trace_recorded.h")
+  #include "trace_recorded.h"
+
+// recorded trace: reference is a centred moving average over +-tau
+static void test_recorded_trace() {
+  std::vector<TraceSample> trace(recordedTrace, recordedTrace + sizeof(recordedTrace) / sizeof(recordedTrace[0]));
+  for (size_t i = 0; i < trace.size(); i++) {
+    uint32_t sum = 0, n = 0;
+    for (size_t j = 0; j < trace.size(); j++) {
+      if (trace[j].timeUs + tauMs * 1000 >= trace[i].timeUs && trace[j].timeUs <= trace[i].timeUs + tauMs * 1000) {
+        sum += trace[j].raw;
+        n++;
+      }
+    }
+    trace[i].truth = sum / n;
+  }
+  for (int type = TH_FILTER_KALMAN; type <= TH_FILTER_ONE_EURO; type++) {
+    FilterResult r = measure((ThrottleFilterType)type, trace);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "recorded %-8s noise %.2f codes, lag to 90 %% %.0f ms", names[type], r.noise, r.lagMs);
+    TEST_MESSAGE(msg);
+  }
+}
+#endif
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_kalman);
+  RUN_TEST(test_critical);
+  RUN_TEST(test_one_euro);
+  RUN_TEST(test_sample_rate_independent);
+#if __has_include("trace_recorded.h")
+  RUN_TEST(test_recorded_trace);
+#endif
+  return UNITY_END();
+}